@@ -0,0 +1,241 @@
+#ifndef __AIR_FRAME_H__
+#define __AIR_FRAME_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Radio frame exchanged between nodes, at most one ESP-NOW payload:
+ *
+ *   [version:3 | routed:1 | kind:4][sequence lo][sequence hi][body]([route])
+ *
+ *   single:   body is one message
+ *   bundle:   [length][message][length][message]...
+ *   fragment: [message id][index][count][part of a message]
+ *   sync:     [network time in us x4], see ChannelHopper
+ *   route:    [origin mac x6][hops left:3 | hops taken:3 | priority:2], only if routed
+ *
+ * The sequence number counts the frames of each sender, so receivers can
+ * drop frames they already had (see DedupTable).
+ * Nodes that forward frames of others (RELAY_HOPS) end theirs with the
+ * route: the sender is then the origin, whoever re-aired the frame, and
+ * its sequence number is the origin's. A forwarder re-airs the frame as it
+ * was but for one hop less left and one more taken, so the body has
+ * AIR_ROUTE_LEN bytes less room.
+ * A bundle carries several short host messages in one radio frame, see Coalescer.
+ * A message longer than one frame is split into up to AIR_MAX_FRAGMENTS
+ * fragments of AIR_MAX_FRAGMENT bytes (the last one shorter), numbered from 0
+ * and reassembled by the receiver, see Reassembler.
+ * A sync frame carries no message: nodes that hop channels (CHANNEL_HOPPING)
+ * keep a common clock with it, it is never routed.
+ * Frames with another version or kind are ignored.
+ */
+
+#define AIR_VERSION 2
+#define AIR_MAX_FRAME 250
+#define AIR_HEADER_LEN 3
+#define AIR_MAX_MESSAGE (AIR_MAX_FRAME - AIR_HEADER_LEN)
+#define AIR_FRAGMENT_HEADER_LEN (AIR_HEADER_LEN + 3)
+#define AIR_MAX_FRAGMENT (AIR_MAX_FRAME - AIR_FRAGMENT_HEADER_LEN)
+#define AIR_MAX_FRAGMENTS 16
+#define AIR_ROUTE_LEN 7
+#define AIR_MAX_ROUTED_FRAGMENT (AIR_MAX_FRAGMENT - AIR_ROUTE_LEN)
+#define AIR_MAX_HOPS 7
+#define AIR_SYNC_LEN (AIR_HEADER_LEN + 4)
+
+#define AIR_FLAG_ROUTED 0x10
+#define AIR_KIND_MASK 0x0F
+
+/**
+ * @brief What follows the air frame header
+ */
+enum AirKind
+{
+  AIR_KIND_SINGLE = 1,   /**< one message, the rest of the frame */
+  AIR_KIND_BUNDLE = 2,   /**< messages each prefixed with a one byte length */
+  AIR_KIND_FRAGMENT = 3, /**< one part of a message longer than a frame */
+  AIR_KIND_SYNC = 4,     /**< the sender's network time, no message */
+};
+
+/**
+ * @brief Position of a fragment within its message
+ */
+struct AirFragment
+{
+  uint8_t messageId; /**< per sender, wraps */
+  uint8_t index;     /**< 0 .. count - 1 */
+  uint8_t count;     /**< fragments in the message */
+  uint8_t size;      /**< bytes in every fragment but the last, less room when routed */
+};
+
+/**
+ * @brief The route at the end of a routed frame
+ */
+struct AirRoute
+{
+  const uint8_t *origin; /**< mac of the node that sent the frame first */
+  uint8_t hopsLeft;      /**< times the frame may still be re-aired */
+  uint8_t hops;          /**< times it was re-aired so far */
+  uint8_t priority;      /**< transmit class of the origin, forwarders keep it */
+};
+
+inline uint8_t airHeader(uint8_t kind)
+{
+  return (AIR_VERSION << 5) | (kind & 0x1F);
+}
+
+/**
+ * @brief stamps the sender's sequence number into a frame, right before it is queued
+ */
+inline void airSetSequence(uint8_t *frame, uint16_t sequence)
+{
+  frame[1] = sequence & 0xFF;
+  frame[2] = sequence >> 8;
+}
+
+/**
+ * @brief sequence number of a frame, check airValid() first
+ */
+inline uint16_t airSequence(const uint8_t *frame)
+{
+  return frame[1] | frame[2] << 8;
+}
+
+inline bool airValid(const uint8_t *frame, size_t length)
+{
+  return length >= AIR_HEADER_LEN + ((frame[0] & AIR_FLAG_ROUTED) ? AIR_ROUTE_LEN : 0) &&
+         (frame[0] >> 5) == AIR_VERSION;
+}
+
+inline bool airRouted(const uint8_t *frame)
+{
+  return frame[0] & AIR_FLAG_ROUTED;
+}
+
+inline uint8_t airKind(const uint8_t *frame)
+{
+  return frame[0] & AIR_KIND_MASK;
+}
+
+/**
+ * @brief stamps the network time into a sync frame, right before it is handed to the radio
+ */
+inline void airSetSyncTime(uint8_t *frame, uint32_t networkUs)
+{
+  for (int b = 0; b < 4; b++)
+  {
+    frame[AIR_HEADER_LEN + b] = networkUs >> (8 * b);
+  }
+}
+
+/**
+ * @brief network time of a sync frame of at least AIR_SYNC_LEN bytes
+ */
+inline uint32_t airSyncTime(const uint8_t *frame)
+{
+  return frame[AIR_HEADER_LEN] | frame[AIR_HEADER_LEN + 1] << 8 | (uint32_t)frame[AIR_HEADER_LEN + 2] << 16 |
+         (uint32_t)frame[AIR_HEADER_LEN + 3] << 24;
+}
+
+/**
+ * @brief appends the route to a frame, it must have AIR_ROUTE_LEN bytes of room
+ *
+ * @return the new frame length
+ */
+inline size_t airAddRoute(uint8_t *frame, size_t length, const uint8_t *origin, uint8_t hopsLeft, uint8_t priority)
+{
+  frame[0] |= AIR_FLAG_ROUTED;
+  memcpy(&frame[length], origin, 6);
+  frame[length + 6] = (hopsLeft & 7) << 5 | (priority & 3);
+  return length + AIR_ROUTE_LEN;
+}
+
+/**
+ * @brief reads the route of a valid routed frame
+ */
+inline AirRoute airRoute(const uint8_t *frame, size_t length)
+{
+  const uint8_t *route = &frame[length - AIR_ROUTE_LEN];
+  AirRoute result = {route, (uint8_t)(route[6] >> 5), (uint8_t)((route[6] >> 2) & 7), (uint8_t)(route[6] & 3)};
+  return result;
+}
+
+/**
+ * @brief counts one hop in the route of a routed frame with hops left, before it is re-aired
+ */
+inline void airTakeHop(uint8_t *frame, size_t length)
+{
+  AirRoute route = airRoute(frame, length);
+  // hops left and taken never add up to more than AIR_MAX_HOPS
+  frame[length - 1] = (route.hopsLeft - 1) << 5 | (route.hops + 1) << 2 | route.priority;
+}
+
+/**
+ * @brief writes the header of a fragment, its data goes at AIR_FRAGMENT_HEADER_LEN
+ */
+inline void airFragmentHeader(uint8_t *frame, const AirFragment &fragment)
+{
+  frame[0] = airHeader(AIR_KIND_FRAGMENT);
+  frame[AIR_HEADER_LEN] = fragment.messageId;
+  frame[AIR_HEADER_LEN + 1] = fragment.index;
+  frame[AIR_HEADER_LEN + 2] = fragment.count;
+}
+
+/**
+ * @brief calls onMessage(message, length) for every message in a radio frame,
+ * or onFragment(fragment, data, length) if it is a fragment. The route of a
+ * routed frame is not part of either
+ *
+ * @return false if the frame is not a valid air frame, messages before the
+ * damaged part of a bundle have been delivered
+ */
+template <typename OnMessage, typename OnFragment>
+inline bool airUnpack(const uint8_t *frame, size_t length, OnMessage onMessage, OnFragment onFragment)
+{
+  if (!airValid(frame, length))
+  {
+    return false;
+  }
+  bool routed = airRouted(frame);
+  if (routed)
+  {
+    length -= AIR_ROUTE_LEN;
+  }
+  switch (airKind(frame))
+  {
+  case AIR_KIND_SINGLE:
+    onMessage(&frame[AIR_HEADER_LEN], length - AIR_HEADER_LEN);
+    return true;
+  case AIR_KIND_BUNDLE:
+  {
+    size_t offset = AIR_HEADER_LEN;
+    while (offset < length)
+    {
+      uint8_t messageLength = frame[offset++];
+      if (messageLength > length - offset)
+      {
+        return false;
+      }
+      onMessage(&frame[offset], messageLength);
+      offset += messageLength;
+    }
+    return true;
+  }
+  case AIR_KIND_FRAGMENT:
+  {
+    if (length < AIR_FRAGMENT_HEADER_LEN)
+    {
+      return false;
+    }
+    AirFragment fragment = {frame[AIR_HEADER_LEN], frame[AIR_HEADER_LEN + 1], frame[AIR_HEADER_LEN + 2],
+                            (uint8_t)(routed ? AIR_MAX_ROUTED_FRAGMENT : AIR_MAX_FRAGMENT)};
+    onFragment(fragment, &frame[AIR_FRAGMENT_HEADER_LEN], length - AIR_FRAGMENT_HEADER_LEN);
+    return true;
+  }
+  default:
+    return false;
+  }
+}
+
+#endif
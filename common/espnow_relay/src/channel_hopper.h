@@ -0,0 +1,196 @@
+#ifndef __CHANNEL_HOPPER_H__
+#define __CHANNEL_HOPPER_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+/**
+ * @brief Where the radio should be at a given time
+ */
+struct ChannelSlot
+{
+  uint8_t channel; /**< radio channel to tune to */
+  bool control;    /**< in the control part of the sync interval */
+  bool quiet;      /**< send nothing: too close to a switch, or only listening */
+};
+
+/**
+ * @brief Control and service channel schedule on a clock shared by the nodes in range
+ *
+ * Time is cut into sync intervals of syncUs. Each starts with controlUs on
+ * the control channel, the rest is spent on a service channel, the next of
+ * the list every interval. Nothing is sent for guardUs after a switch, so
+ * clocks a little apart and nodes that switch late miss nothing, nor for
+ * half of it before one, so frames still in the radio do not spill over.
+ *
+ * The nodes keep a common network time, their own clock plus an offset, with
+ * sync frames. Every node sends one at a random point of each control part
+ * unless it already heard one that was not behind its clock, and adopts any
+ * clock ahead of its own, so the nodes settle on the one that runs latest,
+ * like the timer of an 802.11 ad hoc network. A node that just started
+ * listens on the control channel for scanUs, or until it hears a sync frame.
+ * Groups whose control parts never overlap would never hear each other: one
+ * sync interval in every `rescan`, picked at random per node, a node stays
+ * on the control channel throughout and listens, so the group that runs
+ * behind joins the other one node by node.
+ *
+ * slot() and beaconDue() are called from the task that sends, heard() from
+ * the radio context. They share the offset, the scan and the last interval
+ * a sync frame was heard in through atomics. No hardware dependency: the
+ * caller tunes the radio and sends the sync frames.
+ *
+ * @tparam ServiceChannels number of service channels hopped through
+ */
+template <size_t ServiceChannels>
+class ChannelHopper
+{
+public:
+  /**
+   * @param rescan sync intervals between two listening ones, 0 never to listen
+   */
+  ChannelHopper(uint8_t controlChannel, const uint8_t *serviceChannels, uint32_t syncUs, uint32_t controlUs,
+                uint32_t guardUs, uint32_t rescan)
+      : adjusted(0), beacons(0), controlChannel(controlChannel), syncUs(syncUs), controlUs(controlUs),
+        guardUs(guardUs), rescan(rescan), rescanPhase(0), beaconInterval(0), beaconAtUs(0), beaconDone(true)
+  {
+    for (size_t i = 0; i < ServiceChannels; i++)
+    {
+      this->serviceChannels[i] = serviceChannels[i];
+    }
+    offsetUs.store(0, std::memory_order_relaxed);
+    scanUntilUs.store(0, std::memory_order_relaxed);
+    scanning.store(false, std::memory_order_relaxed);
+    // no interval has this number
+    heardInterval.store(UINT32_MAX, std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief starts listening on the control channel for scanUs
+   *
+   * @param random picks the listening interval of this node
+   */
+  void begin(uint32_t localUs, uint32_t scanUs, uint32_t random)
+  {
+    rescanPhase = rescan != 0 ? random % rescan : 0;
+    scanUntilUs.store(localUs + scanUs, std::memory_order_relaxed);
+    scanning.store(true, std::memory_order_release);
+  }
+
+  /**
+   * @brief the common clock at local time localUs
+   */
+  uint32_t networkUs(uint32_t localUs) const
+  {
+    return localUs + offsetUs.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief where the radio should be at local time localUs
+   */
+  ChannelSlot slot(uint32_t localUs) const
+  {
+    ChannelSlot result = {controlChannel, true, true};
+    if (scanning.load(std::memory_order_acquire) &&
+        (int32_t)(localUs - scanUntilUs.load(std::memory_order_relaxed)) < 0)
+    {
+      return result;
+    }
+    uint32_t now = networkUs(localUs);
+    uint32_t interval = now / syncUs;
+    uint32_t into = now % syncUs;
+    result.control = into < controlUs;
+    if (!result.control && rescan != 0 && interval % rescan == rescanPhase)
+    {
+      // listening for other groups, ours is on the service channel
+      return result;
+    }
+    uint32_t start = result.control ? 0 : controlUs;
+    uint32_t end = result.control ? controlUs : syncUs;
+    // a node switches late, never early: the start of a slot needs the whole
+    // guard, its end only room for the frames still in the radio
+    result.quiet = into - start < guardUs || end - into <= guardUs / 2;
+    if (!result.control)
+    {
+      result.channel = serviceChannels[interval % ServiceChannels];
+    }
+    return result;
+  }
+
+  /**
+   * @brief whether to send a sync frame now, true at most once per sync interval
+   *
+   * @param random picks the point of the control part the frame is due at
+   */
+  bool beaconDue(uint32_t localUs, uint32_t random)
+  {
+    uint32_t now = networkUs(localUs);
+    uint32_t interval = now / syncUs;
+    if (interval != beaconInterval)
+    {
+      beaconInterval = interval;
+      beaconDone = false;
+      uint32_t span = controlUs > 2 * guardUs ? controlUs - 2 * guardUs : 1;
+      beaconAtUs = guardUs + random % span;
+    }
+    ChannelSlot current = slot(localUs);
+    if (beaconDone || !current.control || current.quiet || now % syncUs < beaconAtUs)
+    {
+      return false;
+    }
+    beaconDone = true;
+    if (heardInterval.load(std::memory_order_relaxed) == interval)
+    {
+      // a neighbour already sent the time
+      return false;
+    }
+    beacons++;
+    return true;
+  }
+
+  /**
+   * @brief takes in the network time of a sync frame received at localUs,
+   * radio context
+   */
+  void heard(uint32_t networkUs, uint32_t localUs)
+  {
+    int32_t ahead = (int32_t)(networkUs - this->networkUs(localUs));
+    if (ahead > 0)
+    {
+      offsetUs.fetch_add(ahead, std::memory_order_relaxed);
+      adjusted++;
+    }
+    // up to a guard behind is the time it took on the air, the sender agrees with us
+    if (ahead > -(int32_t)guardUs)
+    {
+      heardInterval.store(this->networkUs(localUs) / syncUs, std::memory_order_relaxed);
+    }
+    scanning.store(false, std::memory_order_release);
+  }
+
+  // times the clock moved ahead to a neighbour's
+  uint32_t adjusted;
+  // sync frames sent
+  uint32_t beacons;
+
+private:
+  uint8_t controlChannel;
+  uint8_t serviceChannels[ServiceChannels];
+  uint32_t syncUs;
+  uint32_t controlUs;
+  uint32_t guardUs;
+  uint32_t rescan;
+  uint32_t rescanPhase;
+
+  std::atomic<uint32_t> offsetUs;
+  std::atomic<uint32_t> scanUntilUs;
+  std::atomic<bool> scanning;
+  std::atomic<uint32_t> heardInterval;
+
+  // own sync frame of the current interval, only used by beaconDue()
+  uint32_t beaconInterval;
+  uint32_t beaconAtUs;
+  bool beaconDone;
+};
+
+#endif
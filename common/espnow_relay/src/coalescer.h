@@ -0,0 +1,95 @@
+#ifndef __COALESCER_H__
+#define __COALESCER_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "air_frame.h"
+
+/**
+ * @brief Packs short messages into one air frame
+ *
+ * The frame is always complete but for the sequence number: a lone message
+ * is kept as AIR_KIND_SINGLE and turned into a bundle when a second one is
+ * added. The caller decides when to send it (size threshold or deadline),
+ * stamps the sequence number and calls clear() once the frame is queued.
+ *
+ * @tparam Capacity largest frame to build, less than AIR_MAX_FRAME to leave
+ * room for a route
+ */
+template <size_t Capacity = AIR_MAX_FRAME>
+class Coalescer
+{
+  static_assert(Capacity > AIR_HEADER_LEN + 1 && Capacity <= AIR_MAX_FRAME, "invalid Coalescer capacity");
+
+public:
+  Coalescer() : length(0), count(0), startedUs(0) {}
+
+  bool empty() const { return count == 0; }
+
+  /**
+   * @brief whether a message of this length can be added to the frame
+   */
+  bool fits(size_t messageLength) const
+  {
+    if (count == 0)
+    {
+      return messageLength <= Capacity - AIR_HEADER_LEN;
+    }
+    // a single becomes a bundle: one more length byte for the first message
+    return length + (count == 1) + 1 + messageLength <= Capacity;
+  }
+
+  /**
+   * @brief appends a message, check fits() first
+   *
+   * @param nowUs time of the call, the first message starts the deadline
+   */
+  void add(const uint8_t *message, size_t messageLength, uint32_t nowUs)
+  {
+    if (count == 0)
+    {
+      frame[0] = airHeader(AIR_KIND_SINGLE);
+      memcpy(&frame[AIR_HEADER_LEN], message, messageLength);
+      length = AIR_HEADER_LEN + messageLength;
+      startedUs = nowUs;
+    }
+    else
+    {
+      if (count == 1)
+      {
+        memmove(&frame[AIR_HEADER_LEN + 1], &frame[AIR_HEADER_LEN], length - AIR_HEADER_LEN);
+        frame[AIR_HEADER_LEN] = length - AIR_HEADER_LEN;
+        frame[0] = airHeader(AIR_KIND_BUNDLE);
+        length++;
+      }
+      frame[length++] = messageLength;
+      memcpy(&frame[length], message, messageLength);
+      length += messageLength;
+    }
+    count++;
+  }
+
+  uint8_t *data() { return frame; }
+  size_t size() const { return length; }
+  uint8_t messages() const { return count; }
+
+  /**
+   * @brief microseconds the first message has been waiting at nowUs
+   */
+  uint32_t age(uint32_t nowUs) const { return nowUs - startedUs; }
+
+  void clear()
+  {
+    length = 0;
+    count = 0;
+  }
+
+private:
+  uint8_t frame[AIR_MAX_FRAME];
+  size_t length;
+  uint8_t count;
+  uint32_t startedUs;
+};
+
+#endif
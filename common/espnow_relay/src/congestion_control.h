@@ -0,0 +1,168 @@
+#ifndef __CONGESTION_CONTROL_H__
+#define __CONGESTION_CONTROL_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+/**
+ * @brief Decentralized congestion control, after the adaptive DCC of ETSI
+ * (LIMERIC)
+ *
+ * Every period the node estimates how busy the channel is: the airtime of
+ * the frames it heard and sent, over the length of the period. The radio
+ * only reports the frames it could decode, so a send the radio refused for
+ * lack of buffers or could not confirm counts as a channel at least at the
+ * target. The share of the airtime the node allows itself then moves toward
+ * what keeps the channel at the target:
+ *
+ *   share += gain / (neighbors + 1) * (target - busy) - decay * share
+ *
+ * Dividing the gain among the nodes in range keeps the loop stable however
+ * dense the network gets, the decay makes nodes that all have traffic settle
+ * on the same share. A token bucket of airtime, filled at the share and
+ * holding up to burstUs, is checked before each send.
+ *
+ * heard() and refused() are called from the radio context, the rest from the
+ * task that sends. Ratios and shares are in permille.
+ */
+class CongestionControl
+{
+public:
+  CongestionControl(uint32_t periodUs, uint32_t target, uint32_t minShare, uint32_t maxShare, uint32_t decay,
+                    uint32_t gain, uint32_t burstUs)
+      : held(0), periodUs(periodUs), target(fraction(target)), minShare(fraction(minShare)),
+        maxShare(fraction(maxShare)), decay(decay), gain(gain), burstUs(burstUs), busy(0), share(fraction(target)),
+        tokensUs(burstUs), sentUs(0), periodStartUs(0), filledUs(0), waiting(false)
+  {
+    heardUs.store(0, std::memory_order_relaxed);
+    refusals.store(0, std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief a frame that took airtimeUs was received, radio context
+   */
+  void heard(uint32_t airtimeUs)
+  {
+    heardUs.fetch_add(airtimeUs, std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief the radio refused a send or could not confirm it, radio context
+   */
+  void refused()
+  {
+    refusals.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief whether the bucket lets a frame go now. It may go into debt by
+   * the frame's airtime, so frames of any length get through
+   */
+  bool ready(uint32_t nowUs)
+  {
+    uint32_t elapsedUs = nowUs - filledUs;
+    filledUs = nowUs;
+    int64_t tokens = tokensUs + ((uint64_t)elapsedUs * share >> 16);
+    tokensUs = tokens > (int64_t)burstUs ? burstUs : (int32_t)tokens;
+    if (tokensUs <= 0)
+    {
+      waiting = true;
+      return false;
+    }
+    return true;
+  }
+
+  /**
+   * @brief a frame taking airtimeUs was handed to the radio
+   */
+  void sent(uint32_t airtimeUs)
+  {
+    held += waiting;
+    waiting = false;
+    tokensUs -= airtimeUs;
+    sentUs += airtimeUs;
+  }
+
+  /**
+   * @brief whether a period is over and update() should run
+   */
+  bool due(uint32_t nowUs) const
+  {
+    return nowUs - periodStartUs >= periodUs;
+  }
+
+  /**
+   * @brief ends the period: estimates the channel load and adapts the share
+   *
+   * @param neighbors nodes heard lately
+   */
+  void update(uint32_t nowUs, size_t neighbors)
+  {
+    uint32_t elapsedUs = nowUs - periodStartUs;
+    periodStartUs = nowUs;
+    uint64_t usedUs = heardUs.exchange(0, std::memory_order_relaxed) + (uint64_t)sentUs;
+    sentUs = 0;
+    uint32_t load = elapsedUs == 0 ? 0 : (usedUs << 16) / elapsedUs;
+    load = load > ONE ? ONE : load;
+    if (refusals.exchange(0, std::memory_order_relaxed) != 0 && load < target)
+    {
+      load = target;
+    }
+    busy = load;
+
+    int64_t step = (int64_t)gain * ((int32_t)target - (int32_t)load) / 1000 / (int64_t)(neighbors + 1) -
+                   (int64_t)decay * share / 1000;
+    int64_t next = (int64_t)share + step;
+    share = next < minShare ? minShare : next > maxShare ? maxShare : (uint32_t)next;
+  }
+
+  /**
+   * @brief channel load of the last period
+   */
+  uint32_t busyPermille() const
+  {
+    return (busy * 1000 + ONE / 2) >> 16;
+  }
+
+  /**
+   * @brief airtime the node allows itself
+   */
+  uint32_t sharePermille() const
+  {
+    return (share * 1000 + ONE / 2) >> 16;
+  }
+
+  // frames that had to wait for the bucket
+  uint32_t held;
+
+private:
+  // ratios inside have 16 fractional bits, so the bucket fills to the µs
+  static constexpr uint32_t ONE = 1 << 16;
+
+  static uint32_t fraction(uint32_t permille)
+  {
+    return ((uint64_t)permille << 16) / 1000;
+  }
+
+  uint32_t periodUs;
+  uint32_t target;
+  uint32_t minShare;
+  uint32_t maxShare;
+  uint32_t decay;
+  uint32_t gain;
+  uint32_t burstUs;
+
+  uint32_t busy;
+  uint32_t share;
+  int32_t tokensUs;
+  uint32_t sentUs;
+  uint32_t periodStartUs;
+  uint32_t filledUs;
+  bool waiting;
+
+  std::atomic<uint32_t> heardUs;
+  std::atomic<uint32_t> refusals;
+};
+
+#endif
@@ -0,0 +1,196 @@
+#ifndef __DEDUP_TABLE_H__
+#define __DEDUP_TABLE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * @brief Per sender duplicate filter over frame sequence numbers
+ *
+ * Each sender has the highest sequence number seen and a 64 bit map of the
+ * ones before it, so reordered frames within the window still pass once.
+ * Senders live in a fixed open addressing table (linear probing, backward
+ * shift deletion) keyed by mac, filled to at most 3/4 of Capacity. When it
+ * is full, the least recently heard sender near the new one's home slot
+ * makes room. A sender silent for longer than the timeout, or jumping back
+ * by more than the window, is taken to have restarted.
+ *
+ * Not thread safe: meant for the radio receive context only.
+ *
+ * @tparam Capacity table slots, power of two
+ */
+template <size_t Capacity>
+class DedupTable
+{
+  static_assert(Capacity >= 4 && (Capacity & (Capacity - 1)) == 0, "DedupTable capacity must be a power of two");
+
+public:
+  static constexpr size_t MAX_SENDERS = Capacity / 4 * 3;
+  static constexpr int WINDOW = 64;
+
+  explicit DedupTable(uint32_t timeoutMs) : duplicates(0), restarts(0), evictions(0), count(0), timeoutMs(timeoutMs)
+  {
+    memset(slots, 0, sizeof(slots));
+  }
+
+  /**
+   * @brief records a frame
+   *
+   * @return false if this sender's frame was seen before and should be dropped
+   */
+  bool accept(const uint8_t *macAddr, uint16_t sequence, uint32_t nowMs)
+  {
+    size_t index = find(macAddr);
+    if (index == Capacity)
+    {
+      insert(macAddr, sequence, nowMs);
+      return true;
+    }
+
+    Entry &entry = slots[index];
+    int16_t delta = sequence - entry.highest;
+    if (nowMs - entry.lastMs > timeoutMs || delta <= -WINDOW)
+    {
+      restarts++;
+      entry.highest = sequence;
+      entry.seen = 1;
+    }
+    else if (delta > 0)
+    {
+      entry.seen = delta >= WINDOW ? 1 : (entry.seen << delta) | 1;
+      entry.highest = sequence;
+    }
+    else
+    {
+      uint64_t bit = (uint64_t)1 << -delta;
+      if (entry.seen & bit)
+      {
+        duplicates++;
+        return false;
+      }
+      entry.seen |= bit;
+    }
+    entry.lastMs = nowMs;
+    return true;
+  }
+
+  size_t size() const { return count; }
+
+  // frames rejected as seen before
+  uint32_t duplicates;
+  // senders whose window was reset after a long silence or a jump back
+  uint32_t restarts;
+  // senders dropped to make room in a full table
+  uint32_t evictions;
+
+private:
+  struct Entry
+  {
+    uint64_t seen; // bit i: frame highest - i was accepted
+    uint32_t lastMs;
+    uint16_t highest;
+    uint8_t macAddr[6];
+    bool used;
+  };
+
+  static size_t home(const uint8_t *macAddr)
+  {
+    uint64_t key = 0;
+    memcpy(&key, macAddr, 6);
+    // Fibonacci hashing, vendors share the first bytes so mix all of them
+    return (key * 0x9E3779B97F4A7C15ull) >> (64 - bits());
+  }
+
+  static constexpr int bits(size_t n = Capacity, int b = 0)
+  {
+    return n == 1 ? b : bits(n >> 1, b + 1);
+  }
+
+  /**
+   * @return slot of the sender, Capacity if it is not in the table
+   */
+  size_t find(const uint8_t *macAddr) const
+  {
+    for (size_t i = home(macAddr);; i = (i + 1) & (Capacity - 1))
+    {
+      const Entry &entry = slots[i];
+      if (!entry.used)
+      {
+        return Capacity;
+      }
+      if (memcmp(entry.macAddr, macAddr, 6) == 0)
+      {
+        return i;
+      }
+    }
+  }
+
+  void insert(const uint8_t *macAddr, uint16_t sequence, uint32_t nowMs)
+  {
+    if (count == MAX_SENDERS)
+    {
+      evict(home(macAddr), nowMs);
+    }
+    size_t i = home(macAddr);
+    while (slots[i].used)
+    {
+      i = (i + 1) & (Capacity - 1);
+    }
+    Entry &entry = slots[i];
+    memcpy(entry.macAddr, macAddr, 6);
+    entry.highest = sequence;
+    entry.seen = 1;
+    entry.lastMs = nowMs;
+    entry.used = true;
+    count++;
+  }
+
+  /**
+   * @brief removes the stalest of the senders in the first slots from start
+   */
+  void evict(size_t start, uint32_t nowMs)
+  {
+    size_t victim = Capacity;
+    for (size_t n = 0, i = start; n < 8 || victim == Capacity; n++, i = (i + 1) & (Capacity - 1))
+    {
+      if (slots[i].used && (victim == Capacity || nowMs - slots[i].lastMs > nowMs - slots[victim].lastMs))
+      {
+        victim = i;
+      }
+    }
+    remove(victim);
+    evictions++;
+  }
+
+  /**
+   * @brief backward shift deletion, keeps every probe chain unbroken without tombstones
+   */
+  void remove(size_t hole)
+  {
+    size_t i = hole;
+    for (;;)
+    {
+      i = (i + 1) & (Capacity - 1);
+      if (!slots[i].used)
+      {
+        break;
+      }
+      // an entry may fill the hole if its home is not between the hole and itself
+      size_t want = home(slots[i].macAddr);
+      if (((i - want) & (Capacity - 1)) >= ((i - hole) & (Capacity - 1)))
+      {
+        slots[hole] = slots[i];
+        hole = i;
+      }
+    }
+    slots[hole].used = false;
+    count--;
+  }
+
+  Entry slots[Capacity];
+  size_t count;
+  uint32_t timeoutMs;
+};
+
+#endif
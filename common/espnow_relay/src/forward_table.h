@@ -0,0 +1,147 @@
+#ifndef __FORWARD_TABLE_H__
+#define __FORWARD_TABLE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include "air_frame.h"
+
+/**
+ * @brief Routed frames of others waiting for their backoff before they are re-aired
+ *
+ * schedule() and cancel() run in the radio context, take() in the task that
+ * queues frames for the radio. A slot changes hands through its state alone:
+ * the radio context fills a free slot and marks it pending, take() claims a
+ * pending slot that is due and cancel() frees one that is not claimed yet,
+ * both with a compare and swap so only one of them wins.
+ *
+ * @tparam Slots frames that can wait at once
+ */
+template <size_t Slots>
+class ForwardTable
+{
+public:
+  ForwardTable() : scheduled(0), cancelled(0), forwarded(0), full(0)
+  {
+    for (size_t i = 0; i < Slots; i++)
+    {
+      slots[i].state.store(FREE, std::memory_order_relaxed);
+    }
+  }
+
+  /**
+   * @brief keeps a copy of a routed frame with hops left, to re-air it at dueUs
+   *
+   * @return false if every slot is taken, the frame is not forwarded
+   */
+  bool schedule(const uint8_t *frame, size_t length, uint32_t dueUs)
+  {
+    for (size_t i = 0; i < Slots; i++)
+    {
+      Slot &slot = slots[i];
+      if (slot.state.load(std::memory_order_acquire) != FREE)
+      {
+        continue;
+      }
+      memcpy(slot.frame, frame, length);
+      slot.length = length;
+      slot.dueUs = dueUs;
+      slot.state.store(PENDING, std::memory_order_release);
+      scheduled++;
+      return true;
+    }
+    full++;
+    return false;
+  }
+
+  /**
+   * @brief drops the pending copy of a frame another node re-aired first
+   *
+   * @param frame the copy heard, with its origin's sequence number and route
+   * @return whether a pending copy was dropped. A copy that took no more
+   * hops than the pending one came from behind and does not count
+   */
+  bool cancel(const uint8_t *frame, size_t length)
+  {
+    AirRoute heard = airRoute(frame, length);
+    uint16_t sequence = airSequence(frame);
+    for (size_t i = 0; i < Slots; i++)
+    {
+      Slot &slot = slots[i];
+      if (slot.state.load(std::memory_order_acquire) != PENDING || airSequence(slot.frame) != sequence)
+      {
+        continue;
+      }
+      AirRoute pending = airRoute(slot.frame, slot.length);
+      if (memcmp(pending.origin, heard.origin, 6) != 0 || heard.hops <= pending.hops)
+      {
+        continue;
+      }
+      uint8_t expected = PENDING;
+      if (slot.state.compare_exchange_strong(expected, FREE, std::memory_order_acq_rel))
+      {
+        cancelled++;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /**
+   * @brief calls send(frame, length) for every frame due at nowUs, with one
+   * hop counted, and frees its slot
+   *
+   * @return number of frames handed to send
+   */
+  template <typename Send>
+  size_t take(uint32_t nowUs, Send send)
+  {
+    size_t count = 0;
+    for (size_t i = 0; i < Slots; i++)
+    {
+      Slot &slot = slots[i];
+      uint8_t expected = PENDING;
+      if (slot.state.load(std::memory_order_acquire) != PENDING || (int32_t)(nowUs - slot.dueUs) < 0 ||
+          !slot.state.compare_exchange_strong(expected, TAKEN, std::memory_order_acq_rel))
+      {
+        continue;
+      }
+      airTakeHop(slot.frame, slot.length);
+      send(slot.frame, slot.length);
+      slot.state.store(FREE, std::memory_order_release);
+      forwarded++;
+      count++;
+    }
+    return count;
+  }
+
+  // frames put aside to be re-aired
+  uint32_t scheduled;
+  // frames given up because a neighbour re-aired them first
+  uint32_t cancelled;
+  // frames handed back to be re-aired
+  uint32_t forwarded;
+  // frames not forwarded for lack of a slot
+  uint32_t full;
+
+private:
+  enum State : uint8_t
+  {
+    FREE,
+    PENDING,
+    TAKEN,
+  };
+
+  struct Slot
+  {
+    std::atomic<uint8_t> state;
+    uint8_t length;
+    uint32_t dueUs;
+    uint8_t frame[AIR_MAX_FRAME];
+  };
+
+  Slot slots[Slots];
+};
+
+#endif
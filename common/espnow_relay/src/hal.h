@@ -0,0 +1,92 @@
+#ifndef __HAL_H__
+#define __HAL_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "radio_settings.h"
+
+/*
+ * Thin hardware layer under the relay core. Each platform is a traits struct
+ * with the same nested static classes, resolved at compile time so the hot
+ * path has no runtime dispatch:
+ *
+ *   struct XxxPlatform
+ *   {
+ *     static constexpr size_t RX_RING_SIZE, TX_QUEUE_DEPTH, REASSEMBLY_SLOTS,  // sizes that fit the chip,
+ *                             DEDUP_TABLE_SIZE, NEIGHBOR_TABLE_SIZE,   // TX_QUEUE_DEPTH per priority class,
+ *                             FORWARD_SLOTS, PEER_KEYS;                // FORWARD_SLOTS used under RELAY_HOPS,
+ *                                                                      // PEER_KEYS unicast peers with a key
+ *     struct Radio
+ *     {
+ *       template <typename Handler> static bool begin();      // Handler::onReceive / Handler::onSent
+ *       static bool setChannel(uint8_t channel);             // 1 to 13, peers follow the radio
+ *       static bool setRate(uint8_t rate);                   // a LinkRate, for the sends after
+ *       static bool setTxPower(uint8_t power);               // 0.25 dBm, RADIO_MIN_TX_POWER to RADIO_MAX_TX_POWER
+ *       static bool addPeer(const uint8_t *macAddr, const uint8_t *lmk = nullptr);  // lmk to encrypt, see PeerCache
+ *       static bool removePeer(const uint8_t *macAddr);
+ *       static RadioStatus send(const uint8_t *macAddr, const uint8_t *data, size_t length);
+ *       static void macAddress(uint8_t *macAddr);
+ *     };
+ *     struct HostSerial { begin(baud), available(), read(buffer, length), write(buffer, length),
+ *                         flush() (wait until sent), setBaud(baud) (change the rate of an open port) };
+ *     struct Board { begin(), led(on), micros(), millis(), delay(ms), restart(), random(),
+ *                    template <typename Handler> poll() };
+ *     template <typename Node> static bool startPipeline();  // run the Node stages in their own tasks, false if unsupported
+ *     static void wake(PipelineStage stage);                   // a stage has new work
+ *   };
+ *
+ * Handler is a class with
+ *   static void onReceive(const uint8_t *macAddr, const uint8_t *data, int length, int8_t rssi);
+ *   static void onSent(const uint8_t *macAddr, bool success);
+ * which the platform's radio callbacks call directly, whatever their native signature.
+ * rssi is in dBm, RADIO_RSSI_UNKNOWN where the radio does not report it.
+ *
+ *   platform_esp32.h    ESP32 Arduino core, esp_now + Serial (or the IDF UART driver)
+ *   platform_esp8266.h  ESP8266 Arduino core, espnow + Serial
+ *   platform_linux.h    UDP multicast on loopback as the air, a pty as the serial port
+ */
+
+#define RADIO_MAX_PAYLOAD 250
+#define RADIO_MAX_PEERS 20
+#define RADIO_MAX_ENCRYPTED_PEERS 6
+#define RADIO_RSSI_UNKNOWN -128
+
+/**
+ * @brief Radio send results, mapped from the platform error codes
+ */
+enum RadioStatus
+{
+  RADIO_OK = 0,
+  RADIO_NOT_INIT,  /**< radio not initialized */
+  RADIO_ARG,       /**< invalid argument */
+  RADIO_NO_MEM,    /**< out of transmit buffers, try again later */
+  RADIO_NOT_FOUND, /**< peer not registered */
+  RADIO_INTERNAL,  /**< internal error */
+  RADIO_ERROR,     /**< any other error */
+};
+
+/**
+ * @brief Stages of the relay, run in turn by relayLoop() or each in its own task
+ */
+enum PipelineStage
+{
+  STAGE_SERIAL_RX, /**< serial port -> host frame queue */
+  STAGE_RADIO_TX,  /**< host frame queue -> radio */
+  STAGE_SERIAL_TX, /**< received packets -> serial port */
+  STAGE_COUNT,
+};
+
+#if defined(ESP32)
+#include "platform_esp32.h"
+typedef Esp32Platform Platform;
+#elif defined(ESP8266)
+#include "platform_esp8266.h"
+typedef Esp8266Platform Platform;
+#elif defined(__linux__)
+#include "platform_linux.h"
+typedef LinuxPlatform Platform;
+#else
+#error "no hardware layer for this platform"
+#endif
+
+#endif
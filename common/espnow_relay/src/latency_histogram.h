@@ -0,0 +1,180 @@
+#ifndef __LATENCY_HISTOGRAM_H__
+#define __LATENCY_HISTOGRAM_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * @brief Legs of a message's way through the relay, one histogram each
+ */
+enum LatencyStage
+{
+  LATENCY_HOST,     /**< host frame complete on the serial port -> queued for the radio (includes coalescing) */
+  LATENCY_TX_QUEUE, /**< queued -> accepted by the radio */
+  LATENCY_AIR,      /**< accepted by the radio -> send callback */
+  LATENCY_RX,       /**< receive callback -> written to the serial port */
+  LATENCY_STAGES,
+};
+
+/**
+ * @brief Fixed size log-linear histogram of durations in microseconds
+ *
+ * Four buckets per power of two, like an HdrHistogram with two bits of
+ * precision: values below 8 us are exact, any other bucket is at most a
+ * quarter of its lower bound wide. The last bucket also takes everything
+ * from 2^23 us (8.4 s) up. record() is a few shifts and an increment.
+ *
+ * Meant to be written by one context; reading from another may see a
+ * sample half recorded, fine for diagnostics. No Arduino dependency, the
+ * host decodes the same histograms.
+ */
+class LatencyHistogram
+{
+public:
+  static constexpr size_t BUCKETS = 88;
+
+  LatencyHistogram() { clear(); }
+
+  void record(uint32_t us)
+  {
+    buckets[bucketOf(us)]++;
+    count++;
+    sumUs += us;
+    if (us > maxUs)
+    {
+      maxUs = us;
+    }
+  }
+
+  void clear()
+  {
+    memset(buckets, 0, sizeof(buckets));
+    count = 0;
+    maxUs = 0;
+    sumUs = 0;
+  }
+
+  static size_t bucketOf(uint32_t us)
+  {
+    if (us < 4)
+    {
+      return us;
+    }
+    int exponent = 31 - __builtin_clz(us);
+    size_t bucket = (exponent - 1) * 4 + ((us >> (exponent - 2)) & 3);
+    return bucket < BUCKETS ? bucket : BUCKETS - 1;
+  }
+
+  /**
+   * @brief smallest duration counted in a bucket
+   */
+  static uint32_t bucketStart(size_t bucket)
+  {
+    if (bucket < 4)
+    {
+      return bucket;
+    }
+    return (uint32_t)(4 + bucket % 4) << (bucket / 4 - 1);
+  }
+
+  /**
+   * @brief duration below which a share of the samples fall, rounded up to
+   * the end of its bucket and never above the largest sample
+   *
+   * @param share 0.5 for the median, 0.99 for p99
+   */
+  uint32_t percentile(double share) const
+  {
+    uint64_t wanted = (uint64_t)(share * count + 0.5);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; i++)
+    {
+      seen += buckets[i];
+      if (seen >= wanted && seen > 0)
+      {
+        uint32_t end = i + 1 < BUCKETS ? bucketStart(i + 1) - 1 : maxUs;
+        return end < maxUs ? end : maxUs;
+      }
+    }
+    return maxUs;
+  }
+
+  uint32_t buckets[BUCKETS];
+  uint32_t count;
+  uint32_t maxUs;
+  uint64_t sumUs;
+};
+
+/*
+ * A LINK_TYPE_LATENCY reply carries one stage, little endian:
+ *
+ *   [stage][stages][count x4][max us x4][sum us x8][bucket counts x4 each]
+ *
+ * stages is the number of replies that make up the dump, 0 when the node
+ * was built without LATENCY_STATS.
+ */
+#define LATENCY_RECORD_LEN (18 + 4 * LatencyHistogram::BUCKETS)
+
+inline size_t latencyEncode(uint8_t *out, uint8_t stage, uint8_t stages, const LatencyHistogram &histogram)
+{
+  out[0] = stage;
+  out[1] = stages;
+  for (int i = 0; i < 8; i++)
+  {
+    if (i < 4)
+    {
+      out[2 + i] = histogram.count >> (8 * i);
+      out[6 + i] = histogram.maxUs >> (8 * i);
+    }
+    out[10 + i] = histogram.sumUs >> (8 * i);
+  }
+  for (size_t b = 0; b < LatencyHistogram::BUCKETS; b++)
+  {
+    for (int i = 0; i < 4; i++)
+    {
+      out[18 + 4 * b + i] = histogram.buckets[b] >> (8 * i);
+    }
+  }
+  return LATENCY_RECORD_LEN;
+}
+
+/**
+ * @brief decodes a LINK_TYPE_LATENCY reply
+ *
+ * @return false if the reply is too short
+ */
+inline bool latencyDecode(const uint8_t *in, size_t length, uint8_t *stage, uint8_t *stages,
+                          LatencyHistogram *histogram)
+{
+  if (length < 2)
+  {
+    return false;
+  }
+  *stage = in[0];
+  *stages = in[1];
+  if (length < LATENCY_RECORD_LEN)
+  {
+    return *stages == 0;
+  }
+  histogram->clear();
+  for (int i = 0; i < 8; i++)
+  {
+    if (i < 4)
+    {
+      histogram->count |= (uint32_t)in[2 + i] << (8 * i);
+      histogram->maxUs |= (uint32_t)in[6 + i] << (8 * i);
+    }
+    histogram->sumUs |= (uint64_t)in[10 + i] << (8 * i);
+  }
+  for (size_t b = 0; b < LatencyHistogram::BUCKETS; b++)
+  {
+    for (int i = 0; i < 4; i++)
+    {
+      histogram->buckets[b] |= (uint32_t)in[18 + 4 * b + i] << (8 * i);
+    }
+  }
+  return true;
+}
+
+#endif
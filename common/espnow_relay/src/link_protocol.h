@@ -0,0 +1,510 @@
+#ifndef __LINK_PROTOCOL_H__
+#define __LINK_PROTOCOL_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "spsc_ring.h"
+
+/*
+ * Host link frame, shared by both firmwares and the host side:
+ *
+ *   [0xA5][0x5A][version:3 | type:5][flags][length lo][length hi][mac x6 if LINK_FLAG_MAC][payload][crc lo][crc hi]
+ *
+ * flags bit 0 is LINK_FLAG_MAC, bits 1-2 the priority class of a data frame (0 most urgent),
+ * bit 3 LINK_FLAG_RADIO.
+ * crc is CRC-16/CCITT-FALSE over everything after the sync word up to the end of the payload.
+ * A receiver that loses a byte drops to the next sync word whose frame passes the crc.
+ */
+
+#define LINK_SYNC0 0xA5
+#define LINK_SYNC1 0x5A
+#define LINK_VERSION 1
+
+#define LINK_HEADER_LEN 6
+#define LINK_MAC_LEN 6
+#define LINK_CRC_LEN 2
+// largest host message, longer than a radio frame: the node fragments it
+#ifndef LINK_MAX_PAYLOAD
+#define LINK_MAX_PAYLOAD 1024
+#endif
+#define LINK_MAX_FRAME (LINK_HEADER_LEN + LINK_MAC_LEN + LINK_MAX_PAYLOAD + LINK_CRC_LEN)
+
+/**
+ * @brief Frame types carried on the host link
+ */
+enum LinkType
+{
+  LINK_TYPE_DATA = 1,      /**< host->node: payload to broadcast, or unicast to mac, node->host: payload from mac */
+  LINK_TYPE_LOG = 2,       /**< node->host: human readable diagnostic text */
+  LINK_TYPE_BAUD = 3,      /**< host->node: proposed baud rate (u32 le), node->host: rate accepted, 0 if refused */
+  LINK_TYPE_ECHO = 4,      /**< host->node: any payload, node->host: the same payload, to measure the link */
+  LINK_TYPE_NEIGHBORS = 5, /**< host->node: empty, node->host: [LINK_NEIGHBORS_MORE or 0][LinkNeighbor records] */
+  LINK_TYPE_LATENCY = 6,   /**< host->node: [LINK_LATENCY_RESET or 0], node->host: one stage per reply (latency_histogram.h) */
+  LINK_TYPE_METRICS = 7,   /**< host->node: empty, or push period ms (u32 le, 0 stops), node->host: metrics block */
+  LINK_TYPE_RADIO = 8,     /**< host->node: radio hint per class from the most urgent, node->host: all of them */
+  LINK_TYPE_PEER = 9,      /**< host->node: mac and its key, empty to remove it, node->host: mac, 1 or 0 if refused */
+};
+
+/**
+ * @brief Frame flags
+ */
+enum LinkFlag
+{
+  LINK_FLAG_MAC = 0x01,      /**< a 6 byte raw mac address follows the header */
+  LINK_FLAG_PRIORITY = 0x06, /**< priority class of a LINK_TYPE_DATA frame, see LinkPriority */
+  LINK_FLAG_RADIO = 0x08,    /**< the payload of a LINK_TYPE_DATA frame starts with a radio hint */
+};
+
+/**
+ * @brief Priority classes of host messages, the node sends a more urgent
+ * class first. Frames from hosts that do not set one are LINK_PRIORITY_URGENT,
+ * which keeps them in arrival order as before.
+ */
+enum LinkPriority
+{
+  LINK_PRIORITY_URGENT = 0, /**< safety messages, e.g. an emergency brake warning */
+  LINK_PRIORITY_HIGH = 1,
+  LINK_PRIORITY_NORMAL = 2,
+  LINK_PRIORITY_BULK = 3, /**< telemetry that may wait */
+};
+
+#define LINK_PRIORITIES 4
+#define LINK_PRIORITY_SHIFT 1
+
+/**
+ * @brief priority class of a frame from its flags
+ */
+inline uint8_t linkPriority(uint8_t flags)
+{
+  return (flags & LINK_FLAG_PRIORITY) >> LINK_PRIORITY_SHIFT;
+}
+
+/**
+ * @brief PHY rates a host can ask for. The DSSS rates use the long preamble,
+ * MCS0 to MCS7 are HT20 with the long guard interval
+ */
+enum LinkRate
+{
+  LINK_RATE_DEFAULT = 0, /**< the class's rate, else the node's RADIO_RATE */
+  LINK_RATE_1M,
+  LINK_RATE_2M,
+  LINK_RATE_5M5,
+  LINK_RATE_11M,
+  LINK_RATE_6M,
+  LINK_RATE_9M,
+  LINK_RATE_12M,
+  LINK_RATE_18M,
+  LINK_RATE_24M,
+  LINK_RATE_36M,
+  LINK_RATE_48M,
+  LINK_RATE_54M,
+  LINK_RATE_MCS0,
+  LINK_RATE_MCS1,
+  LINK_RATE_MCS2,
+  LINK_RATE_MCS3,
+  LINK_RATE_MCS4,
+  LINK_RATE_MCS5,
+  LINK_RATE_MCS6,
+  LINK_RATE_MCS7,
+  LINK_RATES,
+};
+
+// local master key of a unicast peer in a LINK_TYPE_PEER frame
+#define LINK_PEER_KEY_LEN 16
+
+// a radio hint: [LinkRate][transmit power in 0.25 dBm], 0 in either leaves it to the class or the node
+#define LINK_RADIO_HINT_LEN 2
+
+/**
+ * @brief Counters in a LINK_TYPE_METRICS block: [count][u32 le value x count]
+ * in this order. New counters are only ever appended, a host reads the ones
+ * it knows. All are monotonic since boot but the high-water marks and maxima.
+ */
+enum LinkMetric
+{
+  LINK_METRIC_UPTIME_MS,
+  LINK_METRIC_TX_OK,              /**< sends accepted by the radio, then one counter per refusal in RadioStatus order */
+  LINK_METRIC_TX_NOT_INIT,
+  LINK_METRIC_TX_ARG,
+  LINK_METRIC_TX_NO_MEM,          /**< radio out of buffers, the frame is retried */
+  LINK_METRIC_TX_NOT_FOUND,
+  LINK_METRIC_TX_INTERNAL,
+  LINK_METRIC_TX_ERROR,
+  LINK_METRIC_TX_UNCONFIRMED,     /**< send callbacks reporting a failure */
+  LINK_METRIC_TX_DROPPED,         /**< frames discarded by the transmit queue's drop policy */
+  LINK_METRIC_TX_QUEUE_HIGH,      /**< most frames ever queued for the radio */
+  LINK_METRIC_RX_FRAMES,          /**< frames heard, before any check */
+  LINK_METRIC_RX_BYTES,
+  LINK_METRIC_RX_INVALID,         /**< unknown air frame version or kind */
+  LINK_METRIC_RX_DUPLICATES,
+  LINK_METRIC_RX_DROPPED,         /**< messages lost to a full receive ring */
+  LINK_METRIC_RX_RING_HIGH,       /**< most messages ever waiting for the serial port */
+  LINK_METRIC_REASSEMBLED,
+  LINK_METRIC_REASSEMBLY_TIMEOUTS,
+  LINK_METRIC_REASSEMBLY_DROPPED, /**< partial messages evicted or refused for lack of buffers */
+  LINK_METRIC_HOST_FRAMES,        /**< frames decoded from the serial port */
+  LINK_METRIC_HOST_CRC_ERRORS,    /**< serial overruns and line noise end up here */
+  LINK_METRIC_HOST_SKIPPED_BYTES, /**< bytes skipped looking for a frame */
+  LINK_METRIC_HOST_QUEUE_HIGH,    /**< most decoded host frames ever waiting */
+  LINK_METRIC_SERIAL_FRAMES_OUT,  /**< received messages written to the serial port */
+  LINK_METRIC_RECEIVE_CALLBACK_MAX_US,
+  LINK_METRIC_SENT_CALLBACK_MAX_US,
+  LINK_METRIC_RELAY_SCHEDULED,    /**< frames of others put aside to re-air (RELAY_HOPS) */
+  LINK_METRIC_RELAY_FORWARDED,    /**< frames of others re-aired */
+  LINK_METRIC_RELAY_CANCELLED,    /**< given up, a neighbour re-aired them first */
+  LINK_METRIC_RELAY_DROPPED,      /**< not re-aired for lack of a slot */
+  LINK_METRIC_CHANNEL,            /**< radio channel now */
+  LINK_METRIC_CHANNEL_SWITCHES,   /**< times the radio changed channel */
+  LINK_METRIC_SYNC_SENT,          /**< sync frames sent, CHANNEL_HOPPING */
+  LINK_METRIC_SYNC_ADJUSTED,      /**< times the clock moved ahead to a neighbour's */
+  LINK_METRIC_DCC_BUSY,           /**< channel load of the last DCC period, permille */
+  LINK_METRIC_DCC_SHARE,          /**< airtime the node allows itself, permille */
+  LINK_METRIC_DCC_HELD,           /**< frames that waited for the DCC token bucket */
+  LINK_METRIC_RADIO_CHANGES,      /**< times the radio rate or transmit power was changed */
+  LINK_METRIC_RADIO_REFUSED,      /**< changes the radio refused */
+  LINK_METRIC_PEER_HITS,          /**< unicast sends whose peer was registered */
+  LINK_METRIC_PEER_MISSES,        /**< unicast sends that registered their peer first */
+  LINK_METRIC_PEER_EVICTIONS,     /**< peers removed to make room for others */
+  LINK_METRICS,
+};
+
+// in a LINK_TYPE_LATENCY request: clear the histograms once they are sent
+#define LINK_LATENCY_RESET 0x01
+
+// set in the first byte of a LINK_TYPE_NEIGHBORS reply when another reply follows
+#define LINK_NEIGHBORS_MORE 0x01
+#define LINK_NEIGHBOR_LEN 22
+
+/**
+ * @brief One neighbor in a LINK_TYPE_NEIGHBORS reply, LINK_NEIGHBOR_LEN bytes little endian on the link
+ */
+struct LinkNeighbor
+{
+  uint8_t macAddr[LINK_MAC_LEN];
+  uint32_t ageMs;   /**< since the last packet */
+  uint32_t packets; /**< since first heard */
+  uint32_t bytes;
+  uint16_t rate;    /**< packets per second over the last full second */
+  int8_t rssi;      /**< running average in dBm, -128 if unknown */
+  int8_t lastRssi;
+};
+
+inline void linkEncodeNeighbor(uint8_t *out, const LinkNeighbor &neighbor)
+{
+  memcpy(out, neighbor.macAddr, LINK_MAC_LEN);
+  for (int i = 0; i < 4; i++)
+  {
+    out[6 + i] = neighbor.ageMs >> (8 * i);
+    out[10 + i] = neighbor.packets >> (8 * i);
+    out[14 + i] = neighbor.bytes >> (8 * i);
+  }
+  out[18] = neighbor.rate & 0xFF;
+  out[19] = neighbor.rate >> 8;
+  out[20] = neighbor.rssi;
+  out[21] = neighbor.lastRssi;
+}
+
+inline void linkDecodeNeighbor(const uint8_t *in, LinkNeighbor *neighbor)
+{
+  memcpy(neighbor->macAddr, in, LINK_MAC_LEN);
+  neighbor->ageMs = neighbor->packets = neighbor->bytes = 0;
+  for (int i = 0; i < 4; i++)
+  {
+    neighbor->ageMs |= (uint32_t)in[6 + i] << (8 * i);
+    neighbor->packets |= (uint32_t)in[10 + i] << (8 * i);
+    neighbor->bytes |= (uint32_t)in[14 + i] << (8 * i);
+  }
+  neighbor->rate = in[18] | in[19] << 8;
+  neighbor->rssi = in[20];
+  neighbor->lastRssi = in[21];
+}
+
+/**
+ * @brief A decoded host link frame
+ */
+struct LinkFrame
+{
+  uint8_t type;
+  uint8_t flags;
+  uint8_t macAddr[LINK_MAC_LEN];
+  uint16_t length;
+  uint8_t payload[LINK_MAX_PAYLOAD];
+#if defined(LATENCY_STATS) && LATENCY_STATS
+  uint32_t stampUs; /**< time given to feed() with the frame's last byte */
+#endif
+};
+
+/**
+ * @brief continue a CRC-16/CCITT-FALSE over a buffer
+ *
+ * @param crc running value, start with 0xFFFF
+ */
+inline uint16_t linkCrc16(uint16_t crc, const uint8_t *data, size_t length)
+{
+  while (length--)
+  {
+    uint8_t x = (crc >> 8) ^ *data++;
+    x ^= x >> 4;
+    crc = (crc << 8) ^ ((uint16_t)x << 12) ^ ((uint16_t)x << 5) ^ x;
+  }
+  return crc;
+}
+
+/**
+ * @brief write the header and mac of a frame, the payload goes right after
+ *
+ * For building a frame in place: write the header, put the payload at the
+ * returned offset, then seal it with linkSeal().
+ *
+ * @return number of bytes written
+ */
+inline size_t linkEncodeHeader(uint8_t *out, uint8_t type, const uint8_t *macAddr, uint16_t length,
+                               uint8_t priority = LINK_PRIORITY_URGENT, uint8_t flags = 0)
+{
+  size_t n = 0;
+  out[n++] = LINK_SYNC0;
+  out[n++] = LINK_SYNC1;
+  out[n++] = (LINK_VERSION << 5) | (type & 0x1F);
+  out[n++] = (macAddr != nullptr ? LINK_FLAG_MAC : 0) | ((priority << LINK_PRIORITY_SHIFT) & LINK_FLAG_PRIORITY) |
+             (flags & LINK_FLAG_RADIO);
+  out[n++] = length & 0xFF;
+  out[n++] = length >> 8;
+  if (macAddr != nullptr)
+  {
+    memcpy(&out[n], macAddr, LINK_MAC_LEN);
+    n += LINK_MAC_LEN;
+  }
+  return n;
+}
+
+/**
+ * @brief append the crc to a frame built with linkEncodeHeader()
+ *
+ * @param length bytes so far, header and payload
+ * @return length of the complete frame
+ */
+inline size_t linkSeal(uint8_t *frame, size_t length)
+{
+  uint16_t crc = linkCrc16(0xFFFF, &frame[2], length - 2);
+  frame[length++] = crc & 0xFF;
+  frame[length++] = crc >> 8;
+  return length;
+}
+
+/**
+ * @brief write a complete frame into out
+ *
+ * @param out destination, at least LINK_MAX_FRAME bytes
+ * @param type one of LinkType
+ * @param macAddr 6 byte mac address, nullptr to leave it out
+ * @param payload frame payload
+ * @param length payload length, at most LINK_MAX_PAYLOAD
+ * @param priority one of LinkPriority
+ * @param flags LINK_FLAG_RADIO if the payload starts with a radio hint
+ * @return number of bytes written, 0 if length is too large
+ */
+inline size_t linkEncode(uint8_t *out, uint8_t type, const uint8_t *macAddr, const uint8_t *payload, uint16_t length,
+                         uint8_t priority = LINK_PRIORITY_URGENT, uint8_t flags = 0)
+{
+  if (length > LINK_MAX_PAYLOAD)
+  {
+    return 0;
+  }
+  size_t n = linkEncodeHeader(out, type, macAddr, length, priority, flags);
+  if (length > 0)
+  {
+    memcpy(&out[n], payload, length);
+    n += length;
+  }
+  return linkSeal(out, n);
+}
+
+/**
+ * @brief Incremental, resynchronizing decoder for the host link
+ *
+ * Consumes whatever bytes are available, keeps partial frames across calls
+ * and queues complete frames so the caller can handle several of them back
+ * to back. A bad version, oversized length or crc mismatch drops one byte
+ * and searches for the next sync word, so a lost byte costs at most the
+ * frames it overlaps. Has no Arduino dependency.
+ *
+ * wanted()/feed() and front()/pop() may run in two different tasks: the
+ * decoded frames sit in an SpscRing, the raw bytes are only touched by the feeding side.
+ *
+ * @tparam QueueSize number of decoded frames that can wait, power of two
+ */
+template <size_t QueueSize>
+class LinkParser
+{
+public:
+  LinkParser() : decoded(0), crcErrors(0), droppedBytes(0), start(0), end(0) {}
+
+  /**
+   * @brief number of bytes feed() accepts right now
+   *
+   * @return 0 when the internal buffer is full because the frame queue is full
+   */
+  size_t wanted()
+  {
+    // a complete frame may be waiting in raw for a slot the consumer freed
+    parse();
+    compact();
+    return sizeof(raw) - end;
+  }
+
+  /**
+   * @brief parse a chunk of bytes from the serial port
+   *
+   * @param bytes raw bytes as read from the host link
+   * @param length number of bytes in the chunk
+   * @param stampUs when the bytes were read, copied into the frames they complete under LATENCY_STATS
+   * @return number of bytes consumed, less than length only when the frame queue is full
+   */
+  size_t feed(const uint8_t *bytes, size_t length, uint32_t stampUs = 0)
+  {
+#if defined(LATENCY_STATS) && LATENCY_STATS
+    this->stampUs = stampUs;
+#endif
+    size_t consumed = 0;
+    while (consumed < length)
+    {
+      size_t room = wanted();
+      if (room == 0)
+      {
+        break;
+      }
+      if (room > length - consumed)
+      {
+        room = length - consumed;
+      }
+      memcpy(&raw[end], &bytes[consumed], room);
+      end += room;
+      consumed += room;
+      parse();
+    }
+    return consumed;
+  }
+
+  /**
+   * @brief oldest decoded frame, nullptr if none is queued
+   */
+  LinkFrame *front() { return frames.front(); }
+
+  /**
+   * @brief release the frame returned by front()
+   */
+  void pop() { frames.pop(); }
+
+  /**
+   * @brief number of decoded frames waiting
+   */
+  size_t queued() const { return frames.size(); }
+
+  // frames queued since start, only written by the feeding side
+  uint32_t decoded;
+  // frames rejected by the crc check
+  uint32_t crcErrors;
+  // bytes skipped while searching for a sync word
+  uint32_t droppedBytes;
+
+private:
+  void compact()
+  {
+    if (start == 0)
+    {
+      return;
+    }
+    memmove(raw, &raw[start], end - start);
+    end -= start;
+    start = 0;
+  }
+
+  void skip(size_t count)
+  {
+    start += count;
+    droppedBytes += count;
+  }
+
+  void parse()
+  {
+    while (end > start)
+    {
+      const uint8_t *frame = &raw[start];
+      size_t available = end - start;
+
+      if (frame[0] != LINK_SYNC0)
+      {
+        const uint8_t *sync = (const uint8_t *)memchr(frame, LINK_SYNC0, available);
+        skip(sync == nullptr ? available : (size_t)(sync - frame));
+        continue;
+      }
+      if (available < 2)
+      {
+        return;
+      }
+      if (frame[1] != LINK_SYNC1)
+      {
+        skip(1);
+        continue;
+      }
+      if (available < LINK_HEADER_LEN)
+      {
+        return;
+      }
+
+      uint16_t length = frame[4] | (frame[5] << 8);
+      if ((frame[2] >> 5) != LINK_VERSION || length > LINK_MAX_PAYLOAD)
+      {
+        skip(1);
+        continue;
+      }
+      size_t macLen = (frame[3] & LINK_FLAG_MAC) ? LINK_MAC_LEN : 0;
+      size_t total = LINK_HEADER_LEN + macLen + length + LINK_CRC_LEN;
+      if (available < total)
+      {
+        return;
+      }
+
+      uint16_t crc = linkCrc16(0xFFFF, &frame[2], total - 2 - LINK_CRC_LEN);
+      if ((frame[total - 2] | (frame[total - 1] << 8)) != crc)
+      {
+        crcErrors++;
+        skip(1);
+        continue;
+      }
+
+      LinkFrame *slot = frames.acquire();
+      if (slot == nullptr)
+      {
+        // keep the frame in raw until the caller pops one
+        return;
+      }
+      slot->type = frame[2] & 0x1F;
+      slot->flags = frame[3];
+      if (macLen)
+      {
+        memcpy(slot->macAddr, &frame[LINK_HEADER_LEN], LINK_MAC_LEN);
+      }
+      slot->length = length;
+#if defined(LATENCY_STATS) && LATENCY_STATS
+      slot->stampUs = stampUs;
+#endif
+      memcpy(slot->payload, &frame[LINK_HEADER_LEN + macLen], length);
+      frames.commit();
+      decoded++;
+      start += total;
+    }
+  }
+
+  SpscRing<LinkFrame, QueueSize> frames;
+  uint8_t raw[LINK_MAX_FRAME];
+  size_t start;
+  size_t end;
+#if defined(LATENCY_STATS) && LATENCY_STATS
+  // stamp of the last fed bytes, a frame waiting for a free slot keeps it
+  uint32_t stampUs = 0;
+#endif
+};
+
+#endif
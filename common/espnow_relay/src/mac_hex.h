@@ -0,0 +1,25 @@
+#ifndef __MAC_HEX_H__
+#define __MAC_HEX_H__
+
+#include <stdint.h>
+
+// nibble -> lower case hex digit
+constexpr char HEX_DIGITS[16] = {'0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f'};
+
+/**
+ * @brief makes a printable string from a uint8_t mac address array
+ *
+ * @param macAddr uint8_t array contains mac address parts
+ * @param buffer char * to put the printable string of the mac address into, at least 13 bytes
+ */
+inline void formatMacAddress(const uint8_t *macAddr, char *buffer)
+{
+  for (int i = 0; i < 6; i++)
+  {
+    buffer[2 * i] = HEX_DIGITS[macAddr[i] >> 4];
+    buffer[2 * i + 1] = HEX_DIGITS[macAddr[i] & 0x0F];
+  }
+  buffer[12] = '\0';
+}
+
+#endif
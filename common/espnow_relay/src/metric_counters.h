@@ -0,0 +1,55 @@
+#ifndef __METRIC_COUNTERS_H__
+#define __METRIC_COUNTERS_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+/**
+ * @brief Fixed set of 32 bit counters that any context may bump
+ *
+ * add() is a single relaxed atomic add and raise() a compare and swap loop
+ * that only runs while the value grows, so both are safe from the radio
+ * callbacks, the stage tasks and interrupts at once without a lock.
+ * Readers get each counter whole, but not a consistent set.
+ *
+ * @tparam Count number of counters, indexed by the caller's enum
+ */
+template <size_t Count>
+class MetricCounters
+{
+public:
+  MetricCounters()
+  {
+    for (size_t i = 0; i < Count; i++)
+    {
+      values[i].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  void add(size_t id, uint32_t amount = 1)
+  {
+    values[id].fetch_add(amount, std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief keeps the largest value seen, for maxima and high-water marks
+   */
+  void raise(size_t id, uint32_t value)
+  {
+    uint32_t current = values[id].load(std::memory_order_relaxed);
+    while (value > current && !values[id].compare_exchange_weak(current, value, std::memory_order_relaxed))
+    {
+    }
+  }
+
+  uint32_t get(size_t id) const
+  {
+    return values[id].load(std::memory_order_relaxed);
+  }
+
+private:
+  std::atomic<uint32_t> values[Count];
+};
+
+#endif
@@ -0,0 +1,189 @@
+#ifndef __NEIGHBOR_TABLE_H__
+#define __NEIGHBOR_TABLE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "link_protocol.h"
+
+#define NEIGHBOR_RSSI_UNKNOWN -128
+
+/**
+ * @brief Nodes heard recently, with per mac statistics
+ *
+ * Fixed open addressing table in struct of arrays form: the receive path
+ * only scans the packed keys of one group of WAYS slots (a cache line of
+ * keys), so an update costs at most WAYS compares whatever the load. A new
+ * sender takes a free slot of its group, else the least recently heard
+ * one. Entries not heard for the timeout are reported as gone and are the
+ * first to be replaced.
+ *
+ * update() is meant for the radio receive context. Reading from another
+ * task is safe but a record may mix two updates, fine for diagnostics.
+ *
+ * @tparam Capacity slots, a power of two and a multiple of WAYS
+ */
+template <size_t Capacity>
+class NeighborTable
+{
+public:
+  static constexpr size_t WAYS = 8;
+  static_assert(Capacity >= WAYS && (Capacity & (Capacity - 1)) == 0, "NeighborTable capacity must be a power of two");
+
+  explicit NeighborTable(uint32_t timeoutMs) : evictions(0), timeoutMs(timeoutMs)
+  {
+    memset(keys, 0, sizeof(keys));
+  }
+
+  /**
+   * @brief records a packet from macAddr
+   *
+   * @param rssi signal strength in dBm, NEIGHBOR_RSSI_UNKNOWN if the radio does not report it
+   */
+  void update(const uint8_t *macAddr, int8_t rssi, size_t length, uint32_t nowMs)
+  {
+    uint64_t key = keyOf(macAddr);
+    size_t group = groupOf(key);
+    size_t slot = Capacity;
+    size_t victim = group;
+    for (size_t i = group; i < group + WAYS; i++)
+    {
+      if (keys[i] == key)
+      {
+        slot = i;
+        break;
+      }
+      // free slots (key 0) look older than anything
+      if (keys[victim] != 0 && (keys[i] == 0 || nowMs - lastSeenMs[i] > nowMs - lastSeenMs[victim]))
+      {
+        victim = i;
+      }
+    }
+
+    if (slot == Capacity)
+    {
+      slot = victim;
+      evictions += keys[slot] != 0;
+      keys[slot] = key;
+      packets[slot] = 0;
+      bytes[slot] = 0;
+      windowStartMs[slot] = nowMs;
+      windowPackets[slot] = 0;
+      rate[slot] = 0;
+      rssiAverage[slot] = NO_AVERAGE;
+    }
+
+    if (nowMs - windowStartMs[slot] >= 1000)
+    {
+      uint32_t elapsed = nowMs - windowStartMs[slot];
+      rate[slot] = elapsed >= 2000 ? 0 : windowPackets[slot] * 1000 / elapsed;
+      windowStartMs[slot] = nowMs;
+      windowPackets[slot] = 0;
+    }
+    windowPackets[slot]++;
+    packets[slot]++;
+    bytes[slot] += length;
+    lastSeenMs[slot] = nowMs;
+    lastRssi[slot] = rssi;
+    // packets without an rssi leave the average alone, the first one with it starts it
+    if (rssi != NEIGHBOR_RSSI_UNKNOWN)
+    {
+      // average over about 8 packets, kept in 1/16 dB
+      rssiAverage[slot] = rssiAverage[slot] == NO_AVERAGE ? rssi * 16
+                                                          : rssiAverage[slot] + (rssi * 16 - rssiAverage[slot]) / 8;
+    }
+  }
+
+  /**
+   * @brief neighbors heard within the timeout, starting at slot `from`
+   *
+   * @param from first slot to look at, 0 to start
+   * @param out filled with at most max records
+   * @return slot to continue from, Capacity once the table is done
+   */
+  size_t list(size_t from, LinkNeighbor *out, size_t max, size_t *count, uint32_t nowMs) const
+  {
+    *count = 0;
+    for (; from < Capacity && *count < max; from++)
+    {
+      if (keys[from] == 0 || nowMs - lastSeenMs[from] > timeoutMs)
+      {
+        continue;
+      }
+      LinkNeighbor &record = out[(*count)++];
+      uint64_t key = keys[from];
+      for (int b = 0; b < 6; b++)
+      {
+        record.macAddr[b] = key >> (8 * b);
+      }
+      record.ageMs = nowMs - lastSeenMs[from];
+      record.packets = packets[from];
+      record.bytes = bytes[from];
+      record.rate = record.ageMs >= 2000 ? 0 : rate[from];
+      record.rssi = rssiAverage[from] == NO_AVERAGE ? NEIGHBOR_RSSI_UNKNOWN : rssiAverage[from] / 16;
+      record.lastRssi = lastRssi[from];
+    }
+    return from;
+  }
+
+  /**
+   * @brief number of neighbors heard within the timeout
+   */
+  size_t size(uint32_t nowMs) const
+  {
+    size_t count = 0;
+    for (size_t i = 0; i < Capacity; i++)
+    {
+      count += keys[i] != 0 && nowMs - lastSeenMs[i] <= timeoutMs;
+    }
+    return count;
+  }
+
+  // neighbors replaced by a new one in a full group
+  uint32_t evictions;
+
+private:
+  // rssiAverage before the first packet with an rssi, below any average of real ones
+  static constexpr int16_t NO_AVERAGE = NEIGHBOR_RSSI_UNKNOWN * 16;
+
+  /**
+   * @brief the 48 bit mac as an integer, bit 63 set so 0 marks a free slot
+   */
+  static uint64_t keyOf(const uint8_t *macAddr)
+  {
+    uint64_t key = 0;
+    for (int b = 0; b < 6; b++)
+    {
+      key |= (uint64_t)macAddr[b] << (8 * b);
+    }
+    return key | (1ull << 63);
+  }
+
+  /**
+   * @brief first slot of the key's group, from the top bits of a Fibonacci hash
+   */
+  static size_t groupOf(uint64_t key)
+  {
+    return ((key * 0x9E3779B97F4A7C15ull) >> (64 - bits())) & ~(WAYS - 1);
+  }
+
+  static constexpr int bits(size_t n = Capacity, int b = 0)
+  {
+    return n == 1 ? b : bits(n >> 1, b + 1);
+  }
+
+  // hot: scanned on every packet
+  uint64_t keys[Capacity];
+  uint32_t lastSeenMs[Capacity];
+  // written on every packet, read by list()
+  uint32_t packets[Capacity];
+  uint32_t bytes[Capacity];
+  uint32_t windowStartMs[Capacity];
+  uint16_t windowPackets[Capacity];
+  uint16_t rate[Capacity];
+  int16_t rssiAverage[Capacity];
+  int8_t lastRssi[Capacity];
+  uint32_t timeoutMs;
+};
+
+#endif
@@ -0,0 +1,243 @@
+#ifndef __PEER_CACHE_H__
+#define __PEER_CACHE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// local master key of an encrypted peer
+#define PEER_KEY_LEN 16
+
+/**
+ * @brief The peers registered with the radio, within its limit of Peers of
+ * them and Encrypted of those with a key
+ *
+ * ESP-NOW only sends to registered peers, and registering one is a call into
+ * the WiFi stack. A destination is registered on its first send and stays,
+ * so the sends after it are hits. When the radio is full the least recently
+ * used peer makes room, or the least recently used encrypted one when a peer
+ * with a key needs one of the encrypted places. Pinned peers (broadcast) are
+ * never evicted and not counted as hits.
+ *
+ * Keys are set by mac, up to Keys of them, and outlive the eviction of their
+ * peer. A peer gets registered as soon as its key is set: the radio only
+ * decrypts frames of registered peers, so frames from an evicted encrypted
+ * peer are lost until it is sent to again. The last TX_WINDOW destinations
+ * are the most recently used ones, so a peer with frames in flight is not
+ * evicted while Encrypted is larger than the window.
+ *
+ * Called from the task that sends only. No hardware dependency but the two
+ * Radio calls.
+ *
+ * @tparam Radio with static bool addPeer(const uint8_t *macAddr, const uint8_t *lmk),
+ * lmk nullptr for none, and static bool removePeer(const uint8_t *macAddr), see hal.h
+ */
+template <typename Radio, size_t Keys, size_t Peers, size_t Encrypted>
+class PeerCache
+{
+public:
+  PeerCache() : hits(0), misses(0), evictions(0), failed(0), peerCount(0), encryptedCount(0), keyCount(0), uses(0) {}
+
+  /**
+   * @brief registers a peer for good, without a key
+   */
+  bool pin(const uint8_t *macAddr)
+  {
+    int index = find(macAddr);
+    if (index < 0 && !add(macAddr, nullptr))
+    {
+      return false;
+    }
+    peers[index < 0 ? peerCount - 1 : index].pinned = true;
+    return true;
+  }
+
+  /**
+   * @brief makes sure a destination is registered, right before a send to it
+   *
+   * @return false if the radio refused it or every place is pinned
+   */
+  bool acquire(const uint8_t *macAddr)
+  {
+    int index = find(macAddr);
+    if (index >= 0)
+    {
+      hits += !peers[index].pinned;
+      peers[index].usedAt = ++uses;
+      return true;
+    }
+    misses++;
+    return add(macAddr, keyOf(macAddr));
+  }
+
+  /**
+   * @brief sets the key frames to and from a peer are encrypted with
+   *
+   * @param lmk PEER_KEY_LEN bytes, nullptr to remove the key: the peer is
+   * then registered without one on its next send
+   * @return false if the key table is full, the peer is pinned or the radio refused it
+   */
+  bool setKey(const uint8_t *macAddr, const uint8_t *lmk)
+  {
+    int index = find(macAddr);
+    if (index >= 0 && peers[index].pinned)
+    {
+      return false;
+    }
+    if (index >= 0)
+    {
+      // the radio takes a peer's key when it is added
+      remove(index);
+    }
+    int key = findKey(macAddr);
+    if (lmk == nullptr)
+    {
+      if (key >= 0)
+      {
+        keys[key] = keys[--keyCount];
+      }
+      return true;
+    }
+    if (key < 0 && keyCount == Keys)
+    {
+      return false;
+    }
+    // kept only once the radio took it, a refused key leaves the old one in place
+    if (!add(macAddr, lmk))
+    {
+      return false;
+    }
+    if (key < 0)
+    {
+      key = keyCount++;
+      memcpy(keys[key].macAddr, macAddr, 6);
+    }
+    memcpy(keys[key].lmk, lmk, PEER_KEY_LEN);
+    return true;
+  }
+
+  size_t size() const { return peerCount; }
+  size_t encrypted() const { return encryptedCount; }
+
+  // destinations found registered and not, peers evicted for room, registrations that failed
+  uint32_t hits;
+  uint32_t misses;
+  uint32_t evictions;
+  uint32_t failed;
+
+private:
+  struct Peer
+  {
+    uint8_t macAddr[6];
+    bool encrypted;
+    bool pinned;
+    uint32_t usedAt;
+  };
+
+  struct Key
+  {
+    uint8_t macAddr[6];
+    uint8_t lmk[PEER_KEY_LEN];
+  };
+
+  int find(const uint8_t *macAddr) const
+  {
+    for (size_t i = 0; i < peerCount; i++)
+    {
+      if (memcmp(peers[i].macAddr, macAddr, 6) == 0)
+      {
+        return i;
+      }
+    }
+    return -1;
+  }
+
+  int findKey(const uint8_t *macAddr) const
+  {
+    for (size_t i = 0; i < keyCount; i++)
+    {
+      if (memcmp(keys[i].macAddr, macAddr, 6) == 0)
+      {
+        return i;
+      }
+    }
+    return -1;
+  }
+
+  const uint8_t *keyOf(const uint8_t *macAddr) const
+  {
+    int key = findKey(macAddr);
+    return key < 0 ? nullptr : keys[key].lmk;
+  }
+
+  /**
+   * @brief least recently used peer that may go, only encrypted ones if asked, -1 if none
+   */
+  int victim(bool encryptedOnly) const
+  {
+    int oldest = -1;
+    for (size_t i = 0; i < peerCount; i++)
+    {
+      if (!peers[i].pinned && (!encryptedOnly || peers[i].encrypted) &&
+          (oldest < 0 || (int32_t)(peers[i].usedAt - peers[oldest].usedAt) < 0))
+      {
+        oldest = i;
+      }
+    }
+    return oldest;
+  }
+
+  bool add(const uint8_t *macAddr, const uint8_t *lmk)
+  {
+    bool encrypt = lmk != nullptr;
+    if (encrypt && encryptedCount == Encrypted && !evict(victim(true)))
+    {
+      failed++;
+      return false;
+    }
+    if (peerCount == Peers && !evict(victim(false)))
+    {
+      failed++;
+      return false;
+    }
+    if (!Radio::addPeer(macAddr, lmk))
+    {
+      failed++;
+      return false;
+    }
+    Peer &peer = peers[peerCount++];
+    memcpy(peer.macAddr, macAddr, 6);
+    peer.encrypted = encrypt;
+    peer.pinned = false;
+    peer.usedAt = ++uses;
+    encryptedCount += encrypt;
+    return true;
+  }
+
+  bool evict(int index)
+  {
+    if (index < 0)
+    {
+      return false;
+    }
+    remove(index);
+    evictions++;
+    return true;
+  }
+
+  void remove(size_t index)
+  {
+    Radio::removePeer(peers[index].macAddr);
+    encryptedCount -= peers[index].encrypted;
+    peers[index] = peers[--peerCount];
+  }
+
+  Peer peers[Peers];
+  size_t peerCount;
+  size_t encryptedCount;
+  Key keys[Keys];
+  size_t keyCount;
+  uint32_t uses;
+};
+
+#endif
@@ -0,0 +1,365 @@
+#ifndef __PLATFORM_ESP32_H__
+#define __PLATFORM_ESP32_H__
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <esp_now.h>
+#include <esp_wifi.h>
+#include <driver/uart.h>
+
+static_assert(RADIO_PHY_CODES[LINK_RATE_11M] == WIFI_PHY_RATE_11M_L &&
+                  RADIO_PHY_CODES[LINK_RATE_6M] == WIFI_PHY_RATE_6M &&
+                  RADIO_PHY_CODES[LINK_RATE_54M] == WIFI_PHY_RATE_54M &&
+                  RADIO_PHY_CODES[LINK_RATE_MCS7] == WIFI_PHY_RATE_MCS7_LGI,
+              "LinkRate to wifi_phy_rate_t table out of date");
+
+// read the rssi of ESP-NOW frames from a promiscuous mode callback, the
+// receive callback of this core does not report it. Opt-in: the WiFi task
+// then runs the callback for every management frame on the channel, in
+// the context the receive path keeps short
+#ifndef ESP32_RSSI
+#define ESP32_RSSI false
+#endif
+
+// cores and priority of the pipeline tasks (RELAY_PIPELINE): the radio stage runs next to the WiFi stack
+#ifndef PIPELINE_RADIO_CORE
+#define PIPELINE_RADIO_CORE 0
+#endif
+#ifndef PIPELINE_SERIAL_CORE
+#define PIPELINE_SERIAL_CORE 1
+#endif
+#ifndef PIPELINE_PRIORITY
+#define PIPELINE_PRIORITY 5
+#endif
+// bytes per pipeline task: frames to the host are built in static buffers,
+// the deepest stack is a neighbor or metrics reply of the radio tx stage
+#define PIPELINE_STACK_SIZE 4096
+
+// talk to the host through the IDF UART driver instead of Arduino Serial:
+// big driver ring buffers, and the serial rx stage sleeps on the driver's
+// event queue instead of polling every tick
+#ifndef ESP32_UART_DRIVER
+#define ESP32_UART_DRIVER false
+#endif
+#define ESP32_UART_PORT UART_NUM_0
+#ifndef ESP32_UART_RX_BUFFER
+#define ESP32_UART_RX_BUFFER 4096
+#endif
+#ifndef ESP32_UART_TX_BUFFER
+#define ESP32_UART_TX_BUFFER 4096
+#endif
+#define ESP32_UART_EVENTS 16
+
+/**
+ * @brief ESP32 Arduino core: esp_now for the radio, Serial or the IDF UART
+ * driver (ESP32_UART_DRIVER) for the host
+ */
+struct Esp32Platform
+{
+  static constexpr size_t RX_RING_SIZE = 32;
+  static constexpr size_t TX_QUEUE_DEPTH = 8;
+  static constexpr size_t REASSEMBLY_SLOTS = 8;
+  static constexpr size_t DEDUP_TABLE_SIZE = 512;
+  static constexpr size_t NEIGHBOR_TABLE_SIZE = 128;
+  static constexpr size_t FORWARD_SLOTS = 8;
+  static constexpr size_t PEER_KEYS = 16;
+  static constexpr uint8_t LED_PIN = 2;
+
+  struct Radio
+  {
+    /**
+     * @brief sender and rssi of the last management frame, the WiFi task
+     * runs the promiscuous callback right before the receive callback of
+     * the same ESP-NOW frame
+     */
+    struct LastFrame
+    {
+      uint8_t macAddr[6];
+      int8_t rssi;
+    };
+
+    static LastFrame &lastFrame()
+    {
+      static LastFrame frame = {{0}, RADIO_RSSI_UNKNOWN};
+      return frame;
+    }
+
+    static void promiscuousCallback(void *buffer, wifi_promiscuous_pkt_type_t type)
+    {
+      const wifi_promiscuous_pkt_t *packet = (const wifi_promiscuous_pkt_t *)buffer;
+      // ESP-NOW is an action frame, the sender is address 2 of the 802.11 header
+      if (type != WIFI_PKT_MGMT || packet->rx_ctrl.sig_len < 16 || packet->payload[0] != 0xD0)
+      {
+        return;
+      }
+      memcpy(lastFrame().macAddr, &packet->payload[10], 6);
+      lastFrame().rssi = packet->rx_ctrl.rssi;
+    }
+
+    template <typename Handler>
+    static void receiveCallback(const uint8_t *macAddr, const uint8_t *data, int dataLen)
+    {
+      const LastFrame &frame = lastFrame();
+      int8_t rssi = ESP32_RSSI && memcmp(frame.macAddr, macAddr, 6) == 0 ? frame.rssi : RADIO_RSSI_UNKNOWN;
+      Handler::onReceive(macAddr, data, dataLen, rssi);
+    }
+
+    template <typename Handler>
+    static void sentCallback(const uint8_t *macAddr, esp_now_send_status_t status)
+    {
+      Handler::onSent(macAddr, status == ESP_NOW_SEND_SUCCESS);
+    }
+
+    template <typename Handler>
+    static bool begin()
+    {
+      // Set ESP32 in STA mode to begin with, then disconnect from WiFi
+      WiFi.mode(WIFI_STA);
+      WiFi.disconnect();
+
+      if (esp_now_init() != ESP_OK)
+      {
+        return false;
+      }
+      esp_now_register_recv_cb(receiveCallback<Handler>);
+      esp_now_register_send_cb(sentCallback<Handler>);
+#if ESP32_RSSI
+      wifi_promiscuous_filter_t filter = {};
+      filter.filter_mask = WIFI_PROMIS_FILTER_MASK_MGMT;
+      esp_wifi_set_promiscuous_filter(&filter);
+      esp_wifi_set_promiscuous_rx_cb(promiscuousCallback);
+      esp_wifi_set_promiscuous(true);
+#endif
+      return true;
+    }
+
+    static bool setChannel(uint8_t channel)
+    {
+      return esp_wifi_set_channel(channel, WIFI_SECOND_CHAN_NONE) == ESP_OK;
+    }
+
+    static bool setRate(uint8_t rate)
+    {
+      // for every ESP-NOW frame sent from here on, there is no per-frame rate
+      return esp_wifi_config_espnow_rate(WIFI_IF_STA, (wifi_phy_rate_t)RADIO_PHY_CODES[rate]) == ESP_OK;
+    }
+
+    static bool setTxPower(uint8_t power)
+    {
+      return esp_wifi_set_max_tx_power(power) == ESP_OK;
+    }
+
+    static bool addPeer(const uint8_t *macAddr, const uint8_t *lmk = nullptr)
+    {
+      // channel 0: the peer follows the radio when it changes channel
+      esp_now_peer_info_t peerInfo = {};
+      memcpy(peerInfo.peer_addr, macAddr, 6);
+      if (lmk != nullptr)
+      {
+        memcpy(peerInfo.lmk, lmk, ESP_NOW_KEY_LEN);
+        peerInfo.encrypt = true;
+      }
+      if (esp_now_is_peer_exist(macAddr))
+      {
+        return esp_now_mod_peer(&peerInfo) == ESP_OK;
+      }
+      return esp_now_add_peer(&peerInfo) == ESP_OK;
+    }
+
+    static bool removePeer(const uint8_t *macAddr)
+    {
+      return esp_now_del_peer(macAddr) == ESP_OK;
+    }
+
+    /**
+     * @brief the peer setup the firmware did before every broadcast, for TX_BENCHMARK 2 only
+     */
+    static void benchmarkPeerSetup(const uint8_t *macAddr)
+    {
+      esp_now_peer_info_t peerInfo = {};
+      memcpy(peerInfo.peer_addr, macAddr, 6);
+      if (!esp_now_is_peer_exist(macAddr))
+      {
+        esp_now_add_peer(&peerInfo);
+      }
+    }
+
+    static RadioStatus send(const uint8_t *macAddr, const uint8_t *data, size_t length)
+    {
+      switch (esp_now_send(macAddr, data, length))
+      {
+      case ESP_OK:
+        return RADIO_OK;
+      case ESP_ERR_ESPNOW_NOT_INIT:
+        return RADIO_NOT_INIT;
+      case ESP_ERR_ESPNOW_ARG:
+        return RADIO_ARG;
+      case ESP_ERR_ESPNOW_NO_MEM:
+        return RADIO_NO_MEM;
+      case ESP_ERR_ESPNOW_NOT_FOUND:
+        return RADIO_NOT_FOUND;
+      case ESP_ERR_ESPNOW_INTERNAL:
+        return RADIO_INTERNAL;
+      default:
+        return RADIO_ERROR;
+      }
+    }
+
+    static void macAddress(uint8_t *macAddr)
+    {
+      WiFi.macAddress(macAddr);
+    }
+  };
+
+#if ESP32_UART_DRIVER
+  /**
+   * @brief UART0 through the IDF driver, Serial must stay unused
+   *
+   * Every call goes straight to the driver's ring buffers: one
+   * uart_write_bytes() per frame, no Stream layer and no per-byte calls.
+   */
+  struct HostSerial
+  {
+    static QueueHandle_t &events()
+    {
+      static QueueHandle_t queue = nullptr;
+      return queue;
+    }
+
+    static void begin(uint32_t baud)
+    {
+      uart_config_t config = {};
+      config.baud_rate = baud;
+      config.data_bits = UART_DATA_8_BITS;
+      config.parity = UART_PARITY_DISABLE;
+      config.stop_bits = UART_STOP_BITS_1;
+      config.flow_ctrl = UART_HW_FLOWCTRL_DISABLE;
+      uart_param_config(ESP32_UART_PORT, &config);
+      uart_driver_install(ESP32_UART_PORT, ESP32_UART_RX_BUFFER, ESP32_UART_TX_BUFFER, ESP32_UART_EVENTS, &events(),
+                          0);
+    }
+    static size_t available()
+    {
+      size_t length = 0;
+      uart_get_buffered_data_len(ESP32_UART_PORT, &length);
+      return length;
+    }
+    static size_t read(uint8_t *buffer, size_t length)
+    {
+      int count = uart_read_bytes(ESP32_UART_PORT, buffer, length, 0);
+      return count > 0 ? count : 0;
+    }
+    static void write(const uint8_t *buffer, size_t length)
+    {
+      uart_write_bytes(ESP32_UART_PORT, (const char *)buffer, length);
+    }
+    static void flush() { uart_wait_tx_done(ESP32_UART_PORT, portMAX_DELAY); }
+    static void setBaud(uint32_t baud) { uart_set_baudrate(ESP32_UART_PORT, baud); }
+
+    /**
+     * @brief sleeps until the driver reports new bytes, a tick at most
+     */
+    static void waitReadable()
+    {
+      uart_event_t event;
+      if (xQueueReceive(events(), &event, 1) == pdTRUE &&
+          (event.type == UART_FIFO_OVF || event.type == UART_BUFFER_FULL))
+      {
+        // bytes are lost either way, the parser resynchronizes on the next frame
+        uart_flush_input(ESP32_UART_PORT);
+        xQueueReset(events());
+      }
+    }
+  };
+#else
+  struct HostSerial
+  {
+    static void begin(uint32_t baud)
+    {
+      // the default 256 bytes last about 1 ms at 2 Mbaud
+      Serial.setRxBufferSize(1024);
+      Serial.begin(baud);
+    }
+    static size_t available() { return Serial.available(); }
+    static size_t read(uint8_t *buffer, size_t length) { return Serial.readBytes(buffer, length); }
+    static void write(const uint8_t *buffer, size_t length) { Serial.write(buffer, length); }
+    static void flush() { Serial.flush(); }
+    static void setBaud(uint32_t baud) { Serial.updateBaudRate(baud); }
+
+    /**
+     * @brief Serial cannot wake a task, sleep a tick
+     */
+    static void waitReadable() { vTaskDelay(1); }
+  };
+#endif
+
+  struct Board
+  {
+    static void begin() { pinMode(LED_PIN, OUTPUT); }
+    static void led(bool on) { digitalWrite(LED_PIN, on ? HIGH : LOW); }
+    static uint32_t micros() { return ::micros(); }
+    static uint32_t millis() { return ::millis(); }
+    static void delay(uint32_t ms) { ::delay(ms); }
+    static void restart() { ESP.restart(); }
+    static uint32_t random() { return esp_random(); }
+
+    template <typename Handler>
+    static void poll()
+    {
+    }
+  };
+
+  /**
+   * @brief handle of the task running a stage, nullptr while the stages run from loop()
+   */
+  static TaskHandle_t &task(PipelineStage stage)
+  {
+    static TaskHandle_t tasks[STAGE_COUNT] = {};
+    return tasks[stage];
+  }
+
+  /**
+   * @brief runs one stage forever, sleeping until woken, or until the UART has bytes, when idle
+   */
+  template <typename Node, PipelineStage Stage>
+  static void stageTask(void *)
+  {
+    for (;;)
+    {
+      if (!Node::runStage(Stage))
+      {
+        if (Stage == STAGE_SERIAL_RX)
+        {
+          HostSerial::waitReadable();
+        }
+        else
+        {
+          // a tick at most, the stages also have deadlines
+          ulTaskNotifyTake(pdTRUE, 1);
+        }
+      }
+    }
+  }
+
+  template <typename Node>
+  static bool startPipeline()
+  {
+    return xTaskCreatePinnedToCore(stageTask<Node, STAGE_RADIO_TX>, "radio tx", PIPELINE_STACK_SIZE, nullptr,
+                                   PIPELINE_PRIORITY, &task(STAGE_RADIO_TX), PIPELINE_RADIO_CORE) == pdPASS &&
+           xTaskCreatePinnedToCore(stageTask<Node, STAGE_SERIAL_TX>, "serial tx", PIPELINE_STACK_SIZE, nullptr,
+                                   PIPELINE_PRIORITY, &task(STAGE_SERIAL_TX), PIPELINE_SERIAL_CORE) == pdPASS &&
+           xTaskCreatePinnedToCore(stageTask<Node, STAGE_SERIAL_RX>, "serial rx", PIPELINE_STACK_SIZE, nullptr,
+                                   PIPELINE_PRIORITY, &task(STAGE_SERIAL_RX), PIPELINE_SERIAL_CORE) == pdPASS;
+  }
+
+  static void wake(PipelineStage stage)
+  {
+    TaskHandle_t handle = task(stage);
+    if (handle != nullptr)
+    {
+      xTaskNotifyGive(handle);
+    }
+  }
+};
+
+#endif
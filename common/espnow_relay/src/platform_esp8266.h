@@ -0,0 +1,159 @@
+#ifndef __PLATFORM_ESP8266_H__
+#define __PLATFORM_ESP8266_H__
+
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+#include <espnow.h>
+#include "esp_now_8266_fix.h"
+
+/**
+ * @brief ESP8266 Arduino core: espnow for the radio, Serial for the host
+ */
+struct Esp8266Platform
+{
+  // about 80 KB of RAM, half the ESP32 buffers
+  static constexpr size_t RX_RING_SIZE = 16;
+  // per priority class, room for the 5 fragments of a LINK_MAX_PAYLOAD message
+  static constexpr size_t TX_QUEUE_DEPTH = 6;
+  static constexpr size_t REASSEMBLY_SLOTS = 4;
+  static constexpr size_t DEDUP_TABLE_SIZE = 64;
+  static constexpr size_t NEIGHBOR_TABLE_SIZE = 32;
+  static constexpr size_t FORWARD_SLOTS = 4;
+  static constexpr size_t PEER_KEYS = 8;
+
+  struct Radio
+  {
+    template <typename Handler>
+    static void receiveCallback(u8 *macAddr, u8 *data, u8 dataLen)
+    {
+      // the 8266 SDK has no rssi for ESP-NOW frames, and promiscuous mode would stop the station
+      Handler::onReceive(macAddr, data, dataLen, RADIO_RSSI_UNKNOWN);
+    }
+
+    template <typename Handler>
+    static void sentCallback(u8 *macAddr, u8 status)
+    {
+      Handler::onSent(macAddr, status == ESP_NOW_SEND_SUCCESS);
+    }
+
+    template <typename Handler>
+    static bool begin()
+    {
+      // Set ESP8266 in STA mode to begin with, then disconnect from WiFi
+      WiFi.mode(WIFI_STA);
+      WiFi.disconnect();
+
+      if (esp_now_init() != ESP_OK)
+      {
+        return false;
+      }
+      esp_now_set_self_role(ESP_NOW_ROLE_COMBO);
+      esp_now_register_recv_cb(receiveCallback<Handler>);
+      esp_now_register_send_cb(sentCallback<Handler>);
+      return true;
+    }
+
+    static bool setChannel(uint8_t channel)
+    {
+      return wifi_set_channel(channel);
+    }
+
+    static bool setRate(uint8_t rate)
+    {
+      return radioEsp8266Rate(rate);
+    }
+
+    static bool setTxPower(uint8_t power)
+    {
+      // at most 20.5 dBm here
+      system_phy_set_max_tpw(power < 82 ? power : 82);
+      return true;
+    }
+
+    static bool addPeer(const uint8_t *macAddr, const uint8_t *lmk = nullptr)
+    {
+      if (esp_now_is_peer_exist((u8 *)macAddr))
+      {
+        if (lmk == nullptr)
+        {
+          return true;
+        }
+        esp_now_del_peer((u8 *)macAddr);
+      }
+      // channel 0: sends go out on the radio's current channel
+      u8 keyLength = lmk != nullptr ? ESP_NOW_KEY_LEN : 0;
+      return esp_now_add_peer((u8 *)macAddr, ESP_NOW_ROLE_COMBO, 0, (u8 *)lmk, keyLength) == 0;
+    }
+
+    static bool removePeer(const uint8_t *macAddr)
+    {
+      return esp_now_del_peer((u8 *)macAddr) == 0;
+    }
+
+    /**
+     * @brief the role and peer setup the firmware did before every broadcast, for TX_BENCHMARK 2 only
+     */
+    static void benchmarkPeerSetup(const uint8_t *macAddr)
+    {
+      esp_now_set_self_role(ESP_NOW_ROLE_COMBO);
+      if (!esp_now_is_peer_exist((u8 *)macAddr))
+      {
+        esp_now_add_peer((u8 *)macAddr, ESP_NOW_ROLE_COMBO, 0, NULL, 0);
+      }
+    }
+
+    static RadioStatus send(const uint8_t *macAddr, const uint8_t *data, size_t length)
+    {
+      // the 8266 SDK only reports success or failure
+      return esp_now_send((u8 *)macAddr, (u8 *)data, length) == 0 ? RADIO_OK : RADIO_ERROR;
+    }
+
+    static void macAddress(uint8_t *macAddr)
+    {
+      WiFi.macAddress(macAddr);
+    }
+  };
+
+  struct HostSerial
+  {
+    static void begin(uint32_t baud)
+    {
+      // the default 256 bytes last about 1 ms at 2 Mbaud
+      Serial.setRxBufferSize(1024);
+      Serial.begin(baud);
+    }
+    static size_t available() { return Serial.available(); }
+    static size_t read(uint8_t *buffer, size_t length) { return Serial.readBytes(buffer, length); }
+    static void write(const uint8_t *buffer, size_t length) { Serial.write(buffer, length); }
+    static void flush() { Serial.flush(); }
+    static void setBaud(uint32_t baud) { Serial.updateBaudRate(baud); }
+  };
+
+  struct Board
+  {
+    static void begin() {}
+    // LED_BUILTIN shares GPIO2 with UART1 TX on the ESP-12E, leave it alone
+    static void led(bool on) {}
+    static uint32_t micros() { return ::micros(); }
+    static uint32_t millis() { return ::millis(); }
+    static void delay(uint32_t ms) { ::delay(ms); }
+    static void restart() { ESP.restart(); }
+    static uint32_t random() { return ESP.random(); }
+
+    template <typename Handler>
+    static void poll()
+    {
+    }
+  };
+
+  // single core, no pipeline, the stages always run from relayLoop()
+  template <typename Node>
+  static bool startPipeline()
+  {
+    return false;
+  }
+
+  static void wake(PipelineStage stage) {}
+};
+
+#endif
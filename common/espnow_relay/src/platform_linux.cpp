@@ -0,0 +1,684 @@
+#if defined(__linux__) && !defined(ARDUINO)
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include "hal.h"
+#include "mac_hex.h"
+
+// transmit buffers of the simulated radio, sends beyond this report RADIO_NO_MEM
+#define LINUX_TX_BUFFERS 8
+
+// datagram on the simulated air: [source mac][destination mac][channel][LinkRate][start us, little endian][payload]
+#define DATAGRAM_HEADER_LEN 22
+
+// airtime model: the DIFS, slot and contention window of an 802.11 broadcast,
+// how long after the start it picked a node decides to send, and how long a
+// receiver holds a frame after its end for frames that may still overlap it
+#define LINUX_AIR_DIFS_US 50
+#define LINUX_AIR_SLOT_US 20
+#define LINUX_AIR_CW 15
+#define LINUX_AIR_LAG_US 2000
+#define LINUX_AIR_SETTLE_US 4000
+// frames on the air around a node that are kept for carrier sense and collisions
+#define LINUX_AIR_FRAMES 64
+
+LinuxConfig linuxConfig = {1, "239.255.42.1", 42042, nullptr, 0, false};
+
+static const uint8_t BROADCAST_MAC[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+static int airSocket = -1;
+static sockaddr_in airGroup;
+static uint8_t selfMac[6];
+static uint8_t airChannel = 1;
+static uint8_t airRate = LINK_RATE_1M;
+
+// peers registered with the radio, within the limits of ESP-NOW. Nothing is
+// encrypted on the simulated air, a key only takes an encrypted place
+static uint8_t peerMacs[RADIO_MAX_PEERS][6];
+static bool peerEncrypted[RADIO_MAX_PEERS];
+static size_t peerCount = 0;
+
+static int findPeer(const uint8_t *macAddr)
+{
+  for (size_t i = 0; i < peerCount; i++)
+  {
+    if (memcmp(peerMacs[i], macAddr, 6) == 0)
+    {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/**
+ * @brief A frame handed to the simulated radio, completed once it is off the air
+ */
+struct TxBuffer
+{
+  uint8_t datagram[DATAGRAM_HEADER_LEN + RADIO_MAX_PAYLOAD];
+  size_t length;
+  uint64_t handedUs;
+  uint64_t endUs; /**< off the air from then on, 0 without the airtime model */
+  bool onAir;
+};
+
+/**
+ * @brief A frame on the air around this node, ours or one we heard, held
+ * until no frame that overlaps it can still turn up
+ */
+struct AirFrame
+{
+  uint64_t startUs;
+  uint64_t endUs;
+  bool own;       /**< ours: the air is busy and we hear nothing else meanwhile */
+  bool addressed; /**< a broadcast or to us */
+  bool collided;
+  int8_t rssi;
+  size_t length;
+  uint8_t datagram[DATAGRAM_HEADER_LEN + RADIO_MAX_PAYLOAD];
+};
+
+// oldest first, the WiFi task would complete them in that order
+static TxBuffer txBuffers[LINUX_TX_BUFFERS];
+static size_t txCount = 0;
+
+static AirFrame airFrames[LINUX_AIR_FRAMES];
+static size_t airCount = 0;
+// start picked for the next frame and the end of the busy air it was picked from, 0 while none is
+static uint64_t attemptUs = 0;
+static uint64_t attemptFromUs = 0;
+
+static int ptyMaster = -1;
+static int ptySlave = -1;
+
+/**
+ * @brief the machine's clock, the same in every node process, so it times the simulated air
+ */
+static uint64_t monotonicUs()
+{
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/**
+ * @brief derives the locally administered node mac 02:00:00:00:hi:lo from the node id
+ */
+static void loadSelfMac()
+{
+  selfMac[0] = 0x02;
+  selfMac[1] = selfMac[2] = selfMac[3] = 0;
+  selfMac[4] = linuxConfig.nodeId >> 8;
+  selfMac[5] = linuxConfig.nodeId & 0xFF;
+}
+
+static void putStart(uint8_t *datagram, uint64_t startUs)
+{
+  for (int b = 0; b < 8; b++)
+  {
+    datagram[14 + b] = startUs >> (8 * b);
+  }
+}
+
+static uint64_t startOf(const uint8_t *datagram)
+{
+  uint64_t startUs = 0;
+  for (int b = 0; b < 8; b++)
+  {
+    startUs |= (uint64_t)datagram[14 + b] << (8 * b);
+  }
+  return startUs;
+}
+
+/**
+ * @brief next datagram this node can hear: not its own, on its channel and in range
+ *
+ * @param rssi made up from the distance between the node ids
+ * @return datagram length, -1 if none is waiting
+ */
+static ssize_t hear(uint8_t *datagram, int8_t *rssi)
+{
+  ssize_t length;
+  while ((length = recv(airSocket, datagram, DATAGRAM_HEADER_LEN + RADIO_MAX_PAYLOAD, 0)) >= 0)
+  {
+    // node ids stand for positions along a road
+    int distance = abs((int)(datagram[4] << 8 | datagram[5]) - (int)linuxConfig.nodeId);
+    // a radio only hears its own channel, frames sent while it was elsewhere are gone
+    if (length < DATAGRAM_HEADER_LEN || memcmp(datagram, selfMac, 6) == 0 || datagram[12] != airChannel ||
+        (linuxConfig.range != 0 && distance > linuxConfig.range))
+    {
+      continue;
+    }
+    *rssi = distance > 18 ? -94 : -40 - 3 * distance;
+    return length;
+  }
+  return -1;
+}
+
+static bool addressedToUs(const uint8_t *datagram)
+{
+  const uint8_t *destination = &datagram[6];
+  return memcmp(destination, BROADCAST_MAC, 6) == 0 || memcmp(destination, selfMac, 6) == 0;
+}
+
+/**
+ * @brief adds a frame to the air around this node, frames that overlap it
+ * collide, ours included: the radio cannot hear while it sends
+ */
+static void addAirFrame(const uint8_t *datagram, size_t length, bool own, int8_t rssi)
+{
+  uint64_t startUs = startOf(datagram);
+  uint64_t endUs = startUs + radioAirtimeUs(length - DATAGRAM_HEADER_LEN, datagram[13]);
+  bool collided = false;
+  for (size_t i = 0; i < airCount; i++)
+  {
+    if (airFrames[i].startUs < endUs && startUs < airFrames[i].endUs)
+    {
+      airFrames[i].collided = true;
+      collided = true;
+    }
+  }
+  size_t slot = airCount;
+  if (airCount == LINUX_AIR_FRAMES)
+  {
+    // held too long, the oldest is lost
+    slot = 0;
+    for (size_t i = 1; i < airCount; i++)
+    {
+      slot = airFrames[i].startUs < airFrames[slot].startUs ? i : slot;
+    }
+  }
+  else
+  {
+    airCount++;
+  }
+  AirFrame &frame = airFrames[slot];
+  frame.startUs = startUs;
+  frame.endUs = endUs;
+  frame.own = own;
+  frame.addressed = addressedToUs(datagram);
+  frame.collided = collided;
+  frame.rssi = rssi;
+  frame.length = length;
+  memcpy(frame.datagram, datagram, length);
+}
+
+/**
+ * @brief moves every datagram waiting on the socket onto the air around this node
+ */
+static void listen()
+{
+  uint8_t datagram[DATAGRAM_HEADER_LEN + RADIO_MAX_PAYLOAD];
+  int8_t rssi;
+  ssize_t length;
+  while ((length = hear(datagram, &rssi)) >= 0)
+  {
+    addAirFrame(datagram, length, false, rssi);
+  }
+}
+
+/**
+ * @brief end of the last frame on the air that this node knows of
+ */
+static uint64_t busyUntilUs()
+{
+  uint64_t busyUs = 0;
+  for (size_t i = 0; i < airCount; i++)
+  {
+    busyUs = airFrames[i].endUs > busyUs ? airFrames[i].endUs : busyUs;
+  }
+  return busyUs;
+}
+
+/**
+ * @brief whether a frame that ends after fromUs started by atUs
+ */
+static bool busyBetween(uint64_t fromUs, uint64_t atUs)
+{
+  for (size_t i = 0; i < airCount; i++)
+  {
+    if (airFrames[i].endUs > fromUs && airFrames[i].startUs <= atUs)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief picks the start of a frame handed to the radio at handedUs: at
+ * once if the air has been idle for a DIFS, else a DIFS and a random number
+ * of slots after it goes idle. Never further back than a process can be late
+ */
+static void planAttempt(uint64_t handedUs, uint64_t nowUs)
+{
+  attemptFromUs = busyUntilUs();
+  if (attemptFromUs + LINUX_AIR_DIFS_US <= handedUs)
+  {
+    attemptUs = handedUs;
+  }
+  else
+  {
+    uint32_t slots = LinuxPlatform::Board::random() % (LINUX_AIR_CW + 1);
+    attemptUs = attemptFromUs + LINUX_AIR_DIFS_US + slots * LINUX_AIR_SLOT_US;
+  }
+  if (attemptUs + LINUX_AIR_LAG_US < nowUs)
+  {
+    attemptUs = nowUs - LINUX_AIR_LAG_US;
+  }
+}
+
+bool LinuxPlatform::Radio::open()
+{
+  loadSelfMac();
+
+  airSocket = socket(AF_INET, SOCK_DGRAM, 0);
+  if (airSocket < 0)
+  {
+    return false;
+  }
+  int on = 1;
+  setsockopt(airSocket, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  setsockopt(airSocket, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on));
+
+  memset(&airGroup, 0, sizeof(airGroup));
+  airGroup.sin_family = AF_INET;
+  airGroup.sin_port = htons(linuxConfig.port);
+  airGroup.sin_addr.s_addr = inet_addr(linuxConfig.group);
+
+  sockaddr_in local = airGroup;
+  if (bind(airSocket, (sockaddr *)&local, sizeof(local)) < 0)
+  {
+    return false;
+  }
+
+  // every node joins the group on loopback, so the air never leaves the machine
+  ip_mreq membership;
+  membership.imr_multiaddr = airGroup.sin_addr;
+  membership.imr_interface.s_addr = htonl(INADDR_LOOPBACK);
+  in_addr loopback;
+  loopback.s_addr = htonl(INADDR_LOOPBACK);
+  uint8_t ttl = 0;
+  if (setsockopt(airSocket, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) < 0 ||
+      setsockopt(airSocket, IPPROTO_IP, IP_MULTICAST_IF, &loopback, sizeof(loopback)) < 0 ||
+      setsockopt(airSocket, IPPROTO_IP, IP_MULTICAST_LOOP, &on, sizeof(on)) < 0 ||
+      setsockopt(airSocket, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) < 0)
+  {
+    return false;
+  }
+  fcntl(airSocket, F_SETFL, fcntl(airSocket, F_GETFL) | O_NONBLOCK);
+  return true;
+}
+
+bool LinuxPlatform::Radio::setChannel(uint8_t channel)
+{
+  if (channel < 1 || channel > 14)
+  {
+    return false;
+  }
+  airChannel = channel;
+  return true;
+}
+
+bool LinuxPlatform::Radio::setRate(uint8_t rate)
+{
+  if (rate == LINK_RATE_DEFAULT || rate >= LINK_RATES)
+  {
+    return false;
+  }
+  airRate = rate;
+  return true;
+}
+
+bool LinuxPlatform::Radio::setTxPower(uint8_t power)
+{
+  // range is by node id here, the power changes nothing
+  return power >= RADIO_MIN_TX_POWER && power <= RADIO_MAX_TX_POWER;
+}
+
+bool LinuxPlatform::Radio::addPeer(const uint8_t *macAddr, const uint8_t *lmk)
+{
+  int index = findPeer(macAddr);
+  size_t encrypted = 0;
+  for (size_t i = 0; i < peerCount; i++)
+  {
+    encrypted += peerEncrypted[i] && (int)i != index;
+  }
+  if ((index < 0 && peerCount == RADIO_MAX_PEERS) || (lmk != nullptr && encrypted == RADIO_MAX_ENCRYPTED_PEERS))
+  {
+    return false;
+  }
+  if (index < 0)
+  {
+    index = peerCount++;
+    memcpy(peerMacs[index], macAddr, 6);
+  }
+  peerEncrypted[index] = lmk != nullptr;
+  return true;
+}
+
+bool LinuxPlatform::Radio::removePeer(const uint8_t *macAddr)
+{
+  int index = findPeer(macAddr);
+  if (index < 0)
+  {
+    return false;
+  }
+  peerCount--;
+  memcpy(peerMacs[index], peerMacs[peerCount], 6);
+  peerEncrypted[index] = peerEncrypted[peerCount];
+  return true;
+}
+
+RadioStatus LinuxPlatform::Radio::send(const uint8_t *macAddr, const uint8_t *data, size_t length)
+{
+  if (airSocket < 0)
+  {
+    return RADIO_NOT_INIT;
+  }
+  if (length > RADIO_MAX_PAYLOAD)
+  {
+    return RADIO_ARG;
+  }
+  if (findPeer(macAddr) < 0)
+  {
+    return RADIO_NOT_FOUND;
+  }
+  if (txCount == LINUX_TX_BUFFERS)
+  {
+    return RADIO_NO_MEM;
+  }
+
+  TxBuffer &buffer = txBuffers[txCount];
+  memcpy(buffer.datagram, selfMac, 6);
+  memcpy(&buffer.datagram[6], macAddr, 6);
+  buffer.datagram[12] = airChannel;
+  buffer.datagram[13] = airRate;
+  memcpy(&buffer.datagram[DATAGRAM_HEADER_LEN], data, length);
+  buffer.length = DATAGRAM_HEADER_LEN + length;
+  buffer.handedUs = monotonicUs();
+  buffer.endUs = 0;
+  buffer.onAir = false;
+  if (!linuxConfig.airtime)
+  {
+    putStart(buffer.datagram, buffer.handedUs);
+    if (sendto(airSocket, buffer.datagram, buffer.length, 0, (sockaddr *)&airGroup, sizeof(airGroup)) < 0)
+    {
+      return RADIO_INTERNAL;
+    }
+    buffer.onAir = true;
+  }
+  txCount++;
+  if (linuxConfig.airtime)
+  {
+    transmit();
+  }
+  return RADIO_OK;
+}
+
+void LinuxPlatform::Radio::macAddress(uint8_t *macAddr)
+{
+  memcpy(macAddr, selfMac, 6);
+}
+
+void LinuxPlatform::HostSerial::begin(uint32_t)
+{
+  // the baud rate means nothing on a pty
+  ptyMaster = posix_openpt(O_RDWR | O_NOCTTY);
+  if (ptyMaster < 0 || grantpt(ptyMaster) < 0 || unlockpt(ptyMaster) < 0)
+  {
+    perror("posix_openpt");
+    exit(1);
+  }
+  const char *slaveName = ptsname(ptyMaster);
+
+  // keep the slave open so the pty survives the host closing it, raw so no byte is translated or echoed
+  ptySlave = open(slaveName, O_RDWR | O_NOCTTY);
+  termios settings;
+  tcgetattr(ptySlave, &settings);
+  cfmakeraw(&settings);
+  tcsetattr(ptySlave, TCSANOW, &settings);
+  fcntl(ptyMaster, F_SETFL, fcntl(ptyMaster, F_GETFL) | O_NONBLOCK);
+
+  if (linuxConfig.serialLink != nullptr)
+  {
+    unlink(linuxConfig.serialLink);
+    if (symlink(slaveName, linuxConfig.serialLink) < 0)
+    {
+      perror("symlink");
+    }
+  }
+
+  char macStr[13];
+  loadSelfMac();
+  formatMacAddress(selfMac, macStr);
+  fprintf(stderr, "node %u mac %s serial %s\n", linuxConfig.nodeId, macStr,
+          linuxConfig.serialLink != nullptr ? linuxConfig.serialLink : slaveName);
+}
+
+size_t LinuxPlatform::HostSerial::available()
+{
+  int count = 0;
+  if (ioctl(ptyMaster, FIONREAD, &count) < 0)
+  {
+    return 0;
+  }
+  return count;
+}
+
+size_t LinuxPlatform::HostSerial::read(uint8_t *buffer, size_t length)
+{
+  ssize_t count = ::read(ptyMaster, buffer, length);
+  return count < 0 ? 0 : count;
+}
+
+void LinuxPlatform::HostSerial::write(const uint8_t *buffer, size_t length)
+{
+  // like a UART nobody listens to, bytes the host does not pick up are lost once the pty is full
+  while (length > 0)
+  {
+    ssize_t count = ::write(ptyMaster, buffer, length);
+    if (count <= 0)
+    {
+      return;
+    }
+    buffer += count;
+    length -= count;
+  }
+}
+
+// like a board, the clock of a node starts when it does, nodes do not share one
+static const uint64_t bootUs = monotonicUs();
+
+uint32_t LinuxPlatform::Board::micros()
+{
+  return monotonicUs() - bootUs;
+}
+
+uint32_t LinuxPlatform::Board::millis()
+{
+  return (monotonicUs() - bootUs) / 1000;
+}
+
+void LinuxPlatform::Board::delay(uint32_t ms)
+{
+  usleep(ms * 1000);
+}
+
+void LinuxPlatform::Board::restart()
+{
+  exit(1);
+}
+
+uint32_t LinuxPlatform::Board::random()
+{
+  uint32_t value;
+  if (getentropy(&value, sizeof(value)) < 0)
+  {
+    value = micros() ^ getpid();
+  }
+  return value;
+}
+
+/**
+ * @brief shortens waitUs to the time left until atUs
+ */
+static void wakeBy(uint64_t atUs, uint64_t nowUs, uint64_t *waitUs)
+{
+  uint64_t leftUs = atUs > nowUs ? atUs - nowUs : 0;
+  *waitUs = leftUs < *waitUs ? leftUs : *waitUs;
+}
+
+void LinuxPlatform::Board::waitForActivity()
+{
+  // so dozens of nodes can share a machine without spinning
+  uint64_t waitUs = 1000;
+  if (linuxConfig.airtime)
+  {
+    uint64_t nowUs = monotonicUs();
+    if (attemptUs != 0)
+    {
+      wakeBy(attemptUs + LINUX_AIR_LAG_US, nowUs, &waitUs);
+    }
+    if (txCount > 0 && txBuffers[0].onAir)
+    {
+      wakeBy(txBuffers[0].endUs, nowUs, &waitUs);
+    }
+    for (size_t i = 0; i < airCount; i++)
+    {
+      wakeBy(airFrames[i].endUs + LINUX_AIR_SETTLE_US, nowUs, &waitUs);
+    }
+  }
+  pollfd fds[2] = {{airSocket, POLLIN, 0}, {ptyMaster, POLLIN, 0}};
+  timespec timeout = {0, (long)waitUs * 1000};
+  ::ppoll(fds, 2, &timeout, nullptr);
+}
+
+void LinuxPlatform::Radio::transmit()
+{
+  if (!linuxConfig.airtime)
+  {
+    // send() already put them on the air
+    return;
+  }
+  listen();
+  uint64_t nowUs = monotonicUs();
+  size_t next = 0;
+  while (next < txCount && txBuffers[next].onAir)
+  {
+    next++;
+  }
+  while (next < txCount)
+  {
+    TxBuffer &buffer = txBuffers[next];
+    if (attemptUs == 0)
+    {
+      planAttempt(buffer.handedUs, nowUs);
+    }
+    if (nowUs < attemptUs + LINUX_AIR_LAG_US)
+    {
+      return;
+    }
+    // the radio senses the air a slot before it starts, a frame it heard of by then makes it wait
+    if (busyBetween(attemptFromUs, attemptUs - LINUX_AIR_SLOT_US))
+    {
+      attemptUs = 0;
+      continue;
+    }
+    putStart(buffer.datagram, attemptUs);
+    // a frame the socket refuses is lost on the air, it still completes
+    sendto(airSocket, buffer.datagram, buffer.length, 0, (sockaddr *)&airGroup, sizeof(airGroup));
+    buffer.onAir = true;
+    buffer.endUs = attemptUs + radioAirtimeUs(buffer.length - DATAGRAM_HEADER_LEN, buffer.datagram[13]);
+    addAirFrame(buffer.datagram, buffer.length, true, 0);
+    attemptUs = 0;
+    next++;
+  }
+}
+
+size_t LinuxPlatform::Radio::sentCount()
+{
+  uint64_t nowUs = monotonicUs();
+  size_t count = 0;
+  while (count < txCount && txBuffers[count].onAir && txBuffers[count].endUs <= nowUs)
+  {
+    count++;
+  }
+  return count;
+}
+
+const uint8_t *LinuxPlatform::Radio::sentTo(size_t index)
+{
+  return &txBuffers[index].datagram[6];
+}
+
+void LinuxPlatform::Radio::clearSent(size_t count)
+{
+  memmove(txBuffers, &txBuffers[count], (txCount - count) * sizeof(TxBuffer));
+  txCount -= count;
+}
+
+int LinuxPlatform::Radio::receive(uint8_t *macAddr, uint8_t *data, int8_t *rssi)
+{
+  if (!linuxConfig.airtime)
+  {
+    uint8_t datagram[DATAGRAM_HEADER_LEN + RADIO_MAX_PAYLOAD];
+    ssize_t length;
+    while ((length = hear(datagram, rssi)) >= 0)
+    {
+      if (addressedToUs(datagram))
+      {
+        memcpy(macAddr, datagram, 6);
+        memcpy(data, &datagram[DATAGRAM_HEADER_LEN], length - DATAGRAM_HEADER_LEN);
+        return length - DATAGRAM_HEADER_LEN;
+      }
+    }
+    return -1;
+  }
+
+  // frames come out in the order they started once nothing can overlap them any more
+  listen();
+  uint64_t nowUs = monotonicUs();
+  for (;;)
+  {
+    size_t oldest = airCount;
+    for (size_t i = 0; i < airCount; i++)
+    {
+      if (airFrames[i].endUs + LINUX_AIR_SETTLE_US <= nowUs &&
+          (oldest == airCount || airFrames[i].startUs < airFrames[oldest].startUs))
+      {
+        oldest = i;
+      }
+    }
+    if (oldest == airCount)
+    {
+      return -1;
+    }
+    const AirFrame &frame = airFrames[oldest];
+    int length = -1;
+    if (!frame.own && frame.addressed && !frame.collided)
+    {
+      memcpy(macAddr, frame.datagram, 6);
+      length = frame.length - DATAGRAM_HEADER_LEN;
+      memcpy(data, &frame.datagram[DATAGRAM_HEADER_LEN], length);
+      *rssi = frame.rssi;
+    }
+    airFrames[oldest] = airFrames[--airCount];
+    if (length >= 0)
+    {
+      return length;
+    }
+  }
+}
+
+#endif
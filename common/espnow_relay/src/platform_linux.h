@@ -0,0 +1,149 @@
+#ifndef __PLATFORM_LINUX_H__
+#define __PLATFORM_LINUX_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Settings of a simulated node, filled in from the command line before relaySetup()
+ */
+struct LinuxConfig
+{
+  uint16_t nodeId;        /**< last two bytes of the node mac, 02:00:00:00:hi:lo */
+  const char *group;      /**< multicast group that plays the air */
+  uint16_t port;          /**< udp port of the air */
+  const char *serialLink; /**< optional path of a symlink to the pty, nullptr for none */
+  uint16_t range;         /**< hear only nodes whose ids are at most this far from ours, 0 for all */
+  bool airtime;           /**< frames take their airtime and collide, see Radio::transmit() */
+};
+
+extern LinuxConfig linuxConfig;
+
+/**
+ * @brief Simulated node: UDP multicast on loopback as the air, a pty as the serial port
+ */
+struct LinuxPlatform
+{
+  static constexpr size_t RX_RING_SIZE = 32;
+  static constexpr size_t TX_QUEUE_DEPTH = 16;
+  static constexpr size_t REASSEMBLY_SLOTS = 8;
+  static constexpr size_t DEDUP_TABLE_SIZE = 1024;
+  static constexpr size_t NEIGHBOR_TABLE_SIZE = 256;
+  static constexpr size_t FORWARD_SLOTS = 16;
+  static constexpr size_t PEER_KEYS = 16;
+
+  struct Radio
+  {
+    template <typename Handler>
+    static bool begin()
+    {
+      // handlers are called from Board::poll(), the node is single threaded
+      return open();
+    }
+
+    static bool open();
+    static bool setChannel(uint8_t channel);
+    static bool setRate(uint8_t rate);
+    static bool setTxPower(uint8_t power);
+    static bool addPeer(const uint8_t *macAddr, const uint8_t *lmk = nullptr);
+    static bool removePeer(const uint8_t *macAddr);
+    // TX_BENCHMARK 2: the simulated radio never had a per-broadcast setup
+    static void benchmarkPeerSetup(const uint8_t *) {}
+    static RadioStatus send(const uint8_t *macAddr, const uint8_t *data, size_t length);
+    static void macAddress(uint8_t *macAddr);
+
+    /**
+     * @brief puts the frames in the transmit buffers on the air
+     *
+     * Without the airtime model they all go at once. With it a frame takes
+     * radioAirtimeUs() and the radio does what an 802.11 one does for a
+     * broadcast: it waits until the air has been idle for a DIFS, plus a
+     * random number of slots if it was busy, and frames that overlap at a
+     * receiver are both lost there. Processes do not run on time, so a node
+     * decides LINUX_AIR_LAG_US after the start it picked, from the frames it
+     * has heard of by then, and the frame starts when it would have
+     */
+    static void transmit();
+
+    /**
+     * @brief destinations of the sends completed so far, oldest first
+     */
+    static size_t sentCount();
+    static const uint8_t *sentTo(size_t index);
+    static void clearSent(size_t count);
+
+    /**
+     * @brief next packet on the air addressed to this node
+     *
+     * @param rssi made up from the distance between the node ids, -40 dBm next door and 3 dB less per id
+     * @return payload length, -1 if nothing is waiting. Packets of nodes out of range or sent on
+     * another channel are skipped, so are collisions under the airtime model
+     */
+    static int receive(uint8_t *macAddr, uint8_t *data, int8_t *rssi);
+  };
+
+  struct HostSerial
+  {
+    static void begin(uint32_t baud);
+    static size_t available();
+    static size_t read(uint8_t *buffer, size_t length);
+    static void write(const uint8_t *buffer, size_t length);
+    static void flush() {}
+    // a pty has no line speed, the rate only matters to the host side
+    static void setBaud(uint32_t) {}
+  };
+
+  struct Board
+  {
+    static void begin() {}
+    static void led(bool) {}
+    static uint32_t micros();
+    static uint32_t millis();
+    static void delay(uint32_t ms);
+    static void restart();
+    static uint32_t random();
+
+    /**
+     * @brief sleeps up to 1 ms until the air or the host has something, or
+     * the simulated radio has a frame to start or finish
+     */
+    static void waitForActivity();
+
+    template <typename Handler>
+    static void poll()
+    {
+      // complete the sends that are off the air, like the WiFi task would later
+      Radio::transmit();
+      size_t sent = Radio::sentCount();
+      for (size_t i = 0; i < sent; i++)
+      {
+        Handler::onSent(Radio::sentTo(i), true);
+      }
+      Radio::clearSent(sent);
+      if (sent == 0)
+      {
+        waitForActivity();
+      }
+
+      uint8_t macAddr[6];
+      uint8_t data[RADIO_MAX_PAYLOAD];
+      int8_t rssi;
+      int length;
+      while ((length = Radio::receive(macAddr, data, &rssi)) >= 0)
+      {
+        Handler::onReceive(macAddr, data, length, rssi);
+      }
+    }
+  };
+
+  // single threaded, no pipeline, the stages always run from relayLoop()
+  template <typename Node>
+  static bool startPipeline()
+  {
+    return false;
+  }
+
+  static void wake(PipelineStage) {}
+};
+
+#endif
@@ -0,0 +1,144 @@
+#ifndef __RADIO_SETTINGS_H__
+#define __RADIO_SETTINGS_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "link_protocol.h"
+
+// transmit power in 0.25 dBm, the range the ESP32 accepts (2 to 21 dBm)
+#define RADIO_MIN_TX_POWER 8
+#define RADIO_MAX_TX_POWER 84
+
+/**
+ * @brief The ESP radios' number for each LinkRate (wifi_phy_rate_t), the
+ * default is 1 Mbit/s like ESP-NOW itself
+ */
+static constexpr uint8_t RADIO_PHY_CODES[LINK_RATES] = {
+    0x00,                                           // default
+    0x00, 0x01, 0x02, 0x03,                         // 1, 2, 5.5, 11 Mbit/s, long preamble
+    0x0B, 0x0F, 0x0A, 0x0E, 0x09, 0x0D, 0x08, 0x0C, // 6 to 54 Mbit/s
+    0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, // MCS0 to MCS7, long guard interval
+};
+
+/**
+ * @brief microseconds a frame of length payload bytes is on the air: the
+ * preamble, then mac header, action frame and vendor element overhead
+ * (43 bytes) and the payload. ESP-NOW broadcasts at 1 Mbit/s unless told
+ * otherwise
+ *
+ * @param rate one of LinkRate, LINK_RATE_DEFAULT is 1 Mbit/s
+ */
+inline uint32_t radioAirtimeUs(size_t length, uint8_t rate = LINK_RATE_1M)
+{
+  // kbit/s of the DSSS rates, then data bits per 4 µs symbol of the OFDM and HT ones
+  static const uint16_t speeds[LINK_RATES] = {1000, 1000, 2000, 5500, 11000, 24, 36,  48,  72,  96,  144,
+                                              192,  216,  26,   52,   78,   104, 156, 208, 234, 260};
+  uint32_t bits = (43 + length) * 8;
+  if (rate >= LINK_RATES)
+  {
+    rate = LINK_RATE_1M;
+  }
+  if (rate <= LINK_RATE_11M)
+  {
+    return 192 + (bits * 1000 + speeds[rate] - 1) / speeds[rate];
+  }
+  // service and tail bits fill whole symbols after a 20 µs preamble, 36 µs for HT
+  uint32_t symbols = (16 + bits + 6 + speeds[rate] - 1) / speeds[rate];
+  return (rate >= LINK_RATE_MCS0 ? 36 : 20) + 4 * symbols;
+}
+
+/**
+ * @brief whether the ESP8266 can send at a rate: its SDK has no rate setting
+ * for ESP-NOW and always sends at 1 Mbit/s
+ */
+inline bool radioEsp8266Rate(uint8_t rate)
+{
+  return rate == LINK_RATE_1M;
+}
+
+/**
+ * @brief PHY rate and transmit power of a frame, as a host asks for them
+ */
+struct RadioHint
+{
+  uint8_t rate;  /**< one of LinkRate, LINK_RATE_DEFAULT for none */
+  uint8_t power; /**< 0.25 dBm, 0 for none */
+};
+
+/**
+ * @brief Rate and transmit power of the radio, changed only when a frame
+ * asks for others
+ *
+ * A frame gets its own hint where it has one, else the setting of its
+ * class, else the node's. Reconfiguring the radio is a call into the WiFi
+ * stack, and frames in a row mostly share their settings, so apply() keeps
+ * what it last set and only calls the radio for what changed. A setting the
+ * radio refused is kept as well, it is not retried on every frame. No
+ * hardware dependency but the two Radio calls.
+ *
+ * @tparam Radio with static bool setRate(uint8_t rate) taking a LinkRate and
+ * static bool setTxPower(uint8_t power) taking 0.25 dBm, see hal.h
+ */
+template <typename Radio>
+class RadioSettings
+{
+public:
+  /**
+   * @param defaults the node's rate and power, both set
+   */
+  explicit RadioSettings(RadioHint defaults) : changes(0), refused(0), defaults(defaults), current{0, 0} {}
+
+  /**
+   * @brief what a frame is sent with, from its own hint and its class's
+   */
+  RadioHint resolve(RadioHint frame, RadioHint forClass) const
+  {
+    RadioHint result;
+    result.rate = valid(frame).rate ? frame.rate : valid(forClass).rate ? forClass.rate : defaults.rate;
+    uint8_t power = frame.power ? frame.power : forClass.power ? forClass.power : defaults.power;
+    result.power = power < RADIO_MIN_TX_POWER ? RADIO_MIN_TX_POWER : power > RADIO_MAX_TX_POWER ? RADIO_MAX_TX_POWER
+                                                                                                : power;
+    return result;
+  }
+
+  /**
+   * @brief tunes the radio to a resolved setting, right before a send
+   */
+  void apply(RadioHint wanted)
+  {
+    if (wanted.rate != current.rate)
+    {
+      changes++;
+      refused += !Radio::setRate(wanted.rate);
+      current.rate = wanted.rate;
+    }
+    if (wanted.power != current.power)
+    {
+      changes++;
+      refused += !Radio::setTxPower(wanted.power);
+      current.power = wanted.power;
+    }
+  }
+
+  /**
+   * @brief a hint with an unknown rate loses it
+   */
+  static RadioHint valid(RadioHint hint)
+  {
+    if (hint.rate >= LINK_RATES)
+    {
+      hint.rate = LINK_RATE_DEFAULT;
+    }
+    return hint;
+  }
+
+  // calls into the radio, and the ones it refused
+  uint32_t changes;
+  uint32_t refused;
+
+private:
+  RadioHint defaults;
+  RadioHint current;
+};
+
+#endif
@@ -0,0 +1,231 @@
+#ifndef __REASSEMBLER_H__
+#define __REASSEMBLER_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include "air_frame.h"
+
+/**
+ * @brief Rebuilds fragmented messages in a fixed pool of buffers
+ *
+ * Fragments may arrive in any order and more than once; fragment i lands at
+ * i * fragment.size in the buffer of its (sender, message id). A message
+ * that does not complete within the timeout, or that has to make room for a
+ * newer one, is discarded. No sender holds more than PerSender buffers, so a
+ * busy neighbour cannot starve the others.
+ *
+ * add() runs in the radio context. A completed buffer is handed to the
+ * consumer by index, read with message() and returned with release(), which
+ * may happen in another task: the buffer state is the only shared field.
+ *
+ * @tparam Slots number of buffers
+ * @tparam MaxMessage largest message, in bytes
+ * @tparam PerSender buffers one sender may fill at the same time
+ * @tparam Headroom bytes kept free in front of each message, so the consumer
+ * can frame it in place
+ * @tparam Tailroom bytes kept free behind each message
+ */
+template <size_t Slots, size_t MaxMessage, size_t PerSender, size_t Headroom = 0, size_t Tailroom = 0>
+class Reassembler
+{
+  static_assert(MaxMessage <= AIR_MAX_FRAGMENTS * AIR_MAX_ROUTED_FRAGMENT, "message longer than the fragments can carry");
+  static_assert(PerSender >= 1 && PerSender <= Slots, "invalid PerSender");
+
+public:
+  static constexpr int NONE = -1;
+
+  explicit Reassembler(uint32_t timeoutMs)
+      : completed(0), timedOut(0), evicted(0), malformed(0), dropped(0), timeoutMs(timeoutMs)
+  {
+    for (size_t i = 0; i < Slots; i++)
+    {
+      slots[i].state.store(FREE, std::memory_order_relaxed);
+    }
+  }
+
+  /**
+   * @brief stores one fragment
+   *
+   * @param nowMs current time, for the timeouts
+   * @return index of the buffer holding the now complete message, NONE otherwise
+   */
+  int add(const uint8_t *macAddr, const AirFragment &fragment, const uint8_t *data, size_t length, uint32_t nowMs)
+  {
+    bool last = fragment.index + 1 == fragment.count;
+    size_t offset = (size_t)fragment.index * fragment.size;
+    if (fragment.index >= fragment.count || fragment.count > AIR_MAX_FRAGMENTS || offset + length > MaxMessage ||
+        (!last && length != fragment.size))
+    {
+      malformed++;
+      return NONE;
+    }
+
+    int index = find(macAddr, fragment);
+    if (index == NONE)
+    {
+      index = claim(macAddr, nowMs);
+      if (index == NONE)
+      {
+        // every buffer holds a complete message the consumer has not taken yet
+        dropped++;
+        return NONE;
+      }
+      Slot &slot = slots[index];
+      memcpy(slot.macAddr, macAddr, 6);
+      slot.messageId = fragment.messageId;
+      slot.count = fragment.count;
+      slot.received = 0;
+      slot.length = 0;
+      slot.startedMs = nowMs;
+      slot.state.store(FILLING, std::memory_order_relaxed);
+    }
+
+    Slot &slot = slots[index];
+    memcpy(&slot.data[Headroom + offset], data, length);
+    slot.received |= 1u << fragment.index;
+    if (last)
+    {
+      slot.length = offset + length;
+    }
+    if (slot.received != (1u << slot.count) - 1)
+    {
+      return NONE;
+    }
+    completed++;
+    slot.state.store(COMPLETE, std::memory_order_release);
+    return index;
+  }
+
+  /**
+   * @brief a complete message, valid until release()
+   */
+  const uint8_t *message(int index) const { return &slots[index].data[Headroom]; }
+  size_t length(int index) const { return slots[index].length; }
+
+  /**
+   * @brief the whole buffer of a complete message: Headroom bytes, the
+   * message, Tailroom bytes. The consumer may write it until release()
+   */
+  uint8_t *buffer(int index) { return slots[index].data; }
+
+  /**
+   * @brief hands a buffer returned by add() back to the pool
+   */
+  void release(int index)
+  {
+    slots[index].state.store(FREE, std::memory_order_release);
+  }
+
+  // messages delivered complete
+  uint32_t completed;
+  // partial messages discarded after the timeout
+  uint32_t timedOut;
+  // partial messages discarded to make room
+  uint32_t evicted;
+  // fragments with an impossible index, count or length
+  uint32_t malformed;
+  // first fragments refused because no buffer could be freed
+  uint32_t dropped;
+
+private:
+  enum State : uint8_t
+  {
+    FREE,
+    FILLING,
+    COMPLETE,
+  };
+
+  struct Slot
+  {
+    std::atomic<uint8_t> state;
+    uint8_t macAddr[6];
+    uint8_t messageId;
+    uint8_t count;
+    uint32_t received; // bit i set once fragment i arrived
+    size_t length;
+    uint32_t startedMs;
+    uint8_t data[Headroom + MaxMessage + Tailroom];
+  };
+
+  int find(const uint8_t *macAddr, const AirFragment &fragment) const
+  {
+    for (size_t i = 0; i < Slots; i++)
+    {
+      const Slot &slot = slots[i];
+      if (slot.state.load(std::memory_order_relaxed) == FILLING && slot.messageId == fragment.messageId &&
+          slot.count == fragment.count && memcmp(slot.macAddr, macAddr, 6) == 0)
+      {
+        return i;
+      }
+    }
+    return NONE;
+  }
+
+  /**
+   * @brief a buffer for a new message: a free one, else the oldest partial
+   * message of this sender once it has PerSender of them, else the oldest
+   * partial message of anyone. Expired partial messages are freed first.
+   */
+  int claim(const uint8_t *macAddr, uint32_t nowMs)
+  {
+    int free = NONE;
+    int oldest = NONE;
+    int oldestOwn = NONE;
+    size_t own = 0;
+    for (size_t i = 0; i < Slots; i++)
+    {
+      Slot &slot = slots[i];
+      uint8_t state = slot.state.load(std::memory_order_acquire);
+      if (state == FILLING && nowMs - slot.startedMs >= timeoutMs)
+      {
+        timedOut++;
+        slot.state.store(FREE, std::memory_order_relaxed);
+        state = FREE;
+      }
+      if (state == FREE)
+      {
+        free = free == NONE ? (int)i : free;
+        continue;
+      }
+      if (state != FILLING)
+      {
+        continue;
+      }
+      if (oldest == NONE || (int32_t)(slot.startedMs - slots[oldest].startedMs) < 0)
+      {
+        oldest = i;
+      }
+      if (memcmp(slot.macAddr, macAddr, 6) == 0)
+      {
+        own++;
+        if (oldestOwn == NONE || (int32_t)(slot.startedMs - slots[oldestOwn].startedMs) < 0)
+        {
+          oldestOwn = i;
+        }
+      }
+    }
+
+    if (own >= PerSender)
+    {
+      evicted++;
+      return oldestOwn;
+    }
+    if (free != NONE)
+    {
+      return free;
+    }
+    // complete messages belong to the consumer, only a partial one can go
+    if (oldest != NONE)
+    {
+      evicted++;
+    }
+    return oldest;
+  }
+
+  Slot slots[Slots];
+  uint32_t timeoutMs;
+};
+
+#endif
@@ -0,0 +1,13 @@
+#include "relay.h"
+#include "hal.h"
+#include "relay_node.h"
+
+void relaySetup()
+{
+  RelayNode<Platform>::setup();
+}
+
+void relayLoop()
+{
+  RelayNode<Platform>::loop();
+}
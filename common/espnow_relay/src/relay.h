@@ -0,0 +1,223 @@
+#ifndef __RELAY_H__
+#define __RELAY_H__
+
+/*
+ * Relay core shared by every platform: host frames from the serial port are
+ * broadcast over the radio, packets from the radio are forwarded to the host.
+ * Each setting can be overridden from build_flags in platformio.ini.
+ */
+
+#ifndef DEBUG
+#define DEBUG false
+#endif
+
+// rate at boot and after a failed negotiation, and the fastest rate the host
+// may switch to with a LINK_TYPE_BAUD frame. The host confirms the new rate
+// within HOST_BAUD_CONFIRM_MS or the node falls back to HOST_BAUD
+#ifndef HOST_BAUD
+#define HOST_BAUD 115200
+#endif
+#ifndef HOST_MAX_BAUD
+#define HOST_MAX_BAUD 2000000
+#endif
+#ifndef HOST_BAUD_CONFIRM_MS
+#define HOST_BAUD_CONFIRM_MS 500
+#endif
+
+// complete host frames waiting to be queued for the radio
+#ifndef HOST_QUEUE_SIZE
+#define HOST_QUEUE_SIZE 8
+#endif
+
+// 0: normal relay, 1: flood broadcasts through TxEngine and log sends/sec,
+// 2: same flood with the old per-packet peer setup, for comparison
+#ifndef TX_BENCHMARK
+#define TX_BENCHMARK 0
+#endif
+
+// packets handed to the radio but not yet confirmed, and what to do when the
+// queue of a priority class is full: TX_DROP_OLDEST, TX_DROP_NEWEST or TX_BLOCK.
+// Queue and ring sizes come from the platform traits in hal.h
+#ifndef TX_WINDOW
+#define TX_WINDOW 4
+#endif
+#ifndef TX_DROP_POLICY
+#define TX_DROP_POLICY TX_DROP_OLDEST
+#endif
+
+// priority classes with a queue each (1 to LINK_PRIORITIES, 1 sends in
+// arrival order), and how the radio is shared between them: TX_STRICT always
+// sends the most urgent class first, TX_WEIGHTED shares the airtime in the
+// ratio of TX_WEIGHTS, one weight per class starting with the most urgent
+#ifndef TX_CLASSES
+#define TX_CLASSES 4
+#endif
+#ifndef TX_SCHEDULE
+#define TX_SCHEDULE TX_STRICT
+#endif
+#ifndef TX_WEIGHTS
+#define TX_WEIGHTS 8, 4, 2, 1
+#endif
+
+// pack several short host messages into one radio frame, sent once it holds
+// COALESCE_THRESHOLD bytes or its first message waited COALESCE_DEADLINE_US
+#ifndef COALESCE
+#define COALESCE false
+#endif
+#ifndef COALESCE_THRESHOLD
+#define COALESCE_THRESHOLD 200
+#endif
+#ifndef COALESCE_DEADLINE_US
+#define COALESCE_DEADLINE_US 2000
+#endif
+
+// messages longer than a radio frame are fragmented (up to LINK_MAX_PAYLOAD
+// bytes). A partial message is dropped after REASSEMBLY_TIMEOUT_MS, and one
+// sender fills at most REASSEMBLY_PER_SENDER reassembly buffers at a time
+#ifndef REASSEMBLY_TIMEOUT_MS
+#define REASSEMBLY_TIMEOUT_MS 500
+#endif
+#ifndef REASSEMBLY_PER_SENDER
+#define REASSEMBLY_PER_SENDER 2
+#endif
+
+// a sender not heard for DEDUP_TIMEOUT_MS starts a new duplicate window,
+// it has probably restarted
+#ifndef DEDUP_TIMEOUT_MS
+#define DEDUP_TIMEOUT_MS 10000
+#endif
+
+// a neighbor not heard for NEIGHBOR_TIMEOUT_MS is left out of LINK_TYPE_NEIGHBORS replies
+#ifndef NEIGHBOR_TIMEOUT_MS
+#define NEIGHBOR_TIMEOUT_MS 5000
+#endif
+
+// multi-hop: end every frame with a route and re-air frames of others while
+// they have hops left, up to RELAY_HOPS (1 to 7) hops from their origin. 0
+// for single hop. A node waits before it re-airs a frame and gives up when it
+// hears a neighbour re-air it first: RELAY_BACKOFF_US if it heard the frame at
+// RELAY_RSSI_NEAR dBm or louder, nothing at RELAY_RSSI_FAR or weaker, so the
+// farthest receivers go first, plus up to RELAY_JITTER_US at random
+#ifndef RELAY_HOPS
+#define RELAY_HOPS 0
+#endif
+#ifndef RELAY_BACKOFF_US
+#define RELAY_BACKOFF_US 10000
+#endif
+#ifndef RELAY_JITTER_US
+#define RELAY_JITTER_US 2000
+#endif
+#ifndef RELAY_RSSI_NEAR
+#define RELAY_RSSI_NEAR -40
+#endif
+#ifndef RELAY_RSSI_FAR
+#define RELAY_RSSI_FAR -90
+#endif
+
+// radio channel, 1 to 13. With CHANNEL_HOPPING the nodes keep a common clock
+// and every CHANNEL_SYNC_MS spend CHANNEL_CONTROL_MS on RADIO_CHANNEL, where
+// only the most urgent class is sent, then the rest on the next of
+// SERVICE_CHANNELS, where the other classes are. Nothing is sent for
+// CHANNEL_GUARD_US after a switch and half of it before one. One sync
+// interval in CHANNEL_RESCAN a node stays on RADIO_CHANNEL to find nodes
+// whose schedule is out of step, and misses the service part of its own
+#ifndef RADIO_CHANNEL
+#define RADIO_CHANNEL 1
+#endif
+#ifndef CHANNEL_HOPPING
+#define CHANNEL_HOPPING false
+#endif
+#ifndef SERVICE_CHANNELS
+#define SERVICE_CHANNELS 6, 11
+#endif
+#ifndef CHANNEL_SYNC_MS
+#define CHANNEL_SYNC_MS 100
+#endif
+#ifndef CHANNEL_CONTROL_MS
+#define CHANNEL_CONTROL_MS 50
+#endif
+#ifndef CHANNEL_GUARD_US
+#define CHANNEL_GUARD_US 3000
+#endif
+#ifndef CHANNEL_RESCAN
+#define CHANNEL_RESCAN 300
+#endif
+
+// PHY rate (a LinkRate) and transmit power (0.25 dBm) of frames the host gave
+// no radio hint for, directly or through their class. ESP-NOW sends at 1
+// Mbit/s by default: faster rates take a fraction of the air but reach less
+// far, see radio_settings.h
+#ifndef RADIO_RATE
+#define RADIO_RATE LINK_RATE_1M
+#endif
+#ifndef RADIO_TX_POWER
+#define RADIO_TX_POWER 80
+#endif
+
+// decentralized congestion control: every DCC_PERIOD_MS a node estimates the
+// channel load from the airtime of the frames it heard and sent, then moves
+// the share of the air it allows itself toward a load of DCC_TARGET permille:
+// by DCC_GAIN permille of the gap, split among the nodes in range, less
+// DCC_DECAY permille of the share, within DCC_MIN_SHARE and DCC_MAX_SHARE. A
+// token bucket of up to DCC_BURST_US of airtime, filled at the share, holds
+// frames back
+#ifndef DCC
+#define DCC false
+#endif
+#ifndef DCC_PERIOD_MS
+#define DCC_PERIOD_MS 100
+#endif
+#ifndef DCC_TARGET
+#define DCC_TARGET 600
+#endif
+#ifndef DCC_GAIN
+#define DCC_GAIN 500
+#endif
+#ifndef DCC_DECAY
+#define DCC_DECAY 100
+#endif
+#ifndef DCC_MIN_SHARE
+#define DCC_MIN_SHARE 5
+#endif
+#ifndef DCC_MAX_SHARE
+#define DCC_MAX_SHARE 1000
+#endif
+#ifndef DCC_BURST_US
+#define DCC_BURST_US 10000
+#endif
+
+// run the serial reader, radio sender and serial writer each in its own task
+// pinned to a core (ESP32 only, ignored elsewhere), loop() then only reports.
+// PIPELINE_STATS logs per-stage queue depths and rates every PIPELINE_STATS ms
+#ifndef RELAY_PIPELINE
+#define RELAY_PIPELINE false
+#endif
+#ifndef PIPELINE_STATS
+#define PIPELINE_STATS 0
+#endif
+
+// push the LINK_TYPE_METRICS block to the host every METRICS_PERIOD_MS from
+// boot, 0 to only send it on request. The host can change the period
+#ifndef METRICS_PERIOD_MS
+#define METRICS_PERIOD_MS 0
+#endif
+
+// time every message at serial in, queued, accepted by the radio, send
+// callback, receive callback and serial out, and keep a histogram per leg
+// for LINK_TYPE_LATENCY. Off, none of it is compiled in
+#ifndef LATENCY_STATS
+#define LATENCY_STATS false
+#endif
+
+/**
+ * @brief brings up the board, host serial port and radio, call once
+ */
+void relaySetup();
+
+/**
+ * @brief one pass of the relay, never blocks, call repeatedly
+ * (from loop() on the boards, from main() on Linux)
+ */
+void relayLoop();
+
+#endif
@@ -0,0 +1,1256 @@
+#ifndef __RELAY_NODE_H__
+#define __RELAY_NODE_H__
+
+#include <stdio.h>
+#include <string.h>
+#include "relay.h"
+#include "hal.h"
+#include "spsc_ring.h"
+#include "air_frame.h"
+#include "channel_hopper.h"
+#include "coalescer.h"
+#include "congestion_control.h"
+#include "forward_table.h"
+#include "reassembler.h"
+#include "dedup_table.h"
+#include "neighbor_table.h"
+#include "latency_histogram.h"
+#include "metric_counters.h"
+#include "link_protocol.h"
+#include "mac_hex.h"
+#include "radio_settings.h"
+#include "tx_queue.h"
+#include "tx_engine.h"
+
+/**
+ * @brief The relay core, written once for every platform
+ *
+ * Host frames from the serial port are broadcast over the radio, packets
+ * from the radio are forwarded to the host. All state is static: there is
+ * one node per program and the platform's radio callbacks call onReceive()
+ * and onSent() directly.
+ *
+ * @tparam P platform traits, see hal.h
+ */
+template <typename P>
+class RelayNode
+{
+  static_assert(TX_CLASSES >= 1 && TX_CLASSES <= LINK_PRIORITIES, "TX_CLASSES must be 1 to LINK_PRIORITIES");
+  static_assert(LINK_METRIC_TX_ERROR - LINK_METRIC_TX_OK == RADIO_ERROR, "send counters follow RadioStatus");
+  static_assert(RELAY_HOPS >= 0 && RELAY_HOPS <= AIR_MAX_HOPS, "RELAY_HOPS must be 0 to AIR_MAX_HOPS");
+  static_assert(CHANNEL_CONTROL_MS > 0 && CHANNEL_CONTROL_MS < CHANNEL_SYNC_MS,
+                "the control part must leave room for a service part");
+
+  // own frames leave room for the route when they may be re-aired
+  static constexpr size_t TX_MAX_FRAME = RELAY_HOPS ? AIR_MAX_FRAME - AIR_ROUTE_LEN : AIR_MAX_FRAME;
+  static constexpr size_t TX_FRAGMENT = RELAY_HOPS ? AIR_MAX_ROUTED_FRAGMENT : AIR_MAX_FRAGMENT;
+
+  // service channels of CHANNEL_HOPPING, in the order they are used
+  static constexpr uint8_t SERVICE_CHANNEL_LIST[] = {SERVICE_CHANNELS};
+  typedef ChannelHopper<sizeof(SERVICE_CHANNEL_LIST)> Hopper;
+
+public:
+  typedef typename P::Radio Radio;
+  typedef typename P::HostSerial HostSerial;
+  typedef typename P::Board Board;
+
+  // room for the link header and mac in front of a reassembled message and the crc behind it
+  typedef Reassembler<P::REASSEMBLY_SLOTS, LINK_MAX_PAYLOAD, REASSEMBLY_PER_SENDER, LINK_HEADER_LEN + LINK_MAC_LEN,
+                      LINK_CRC_LEN>
+      RxReassembler;
+
+  /**
+   * @brief A received message waiting in rxRing, already laid out as the
+   * LINK_TYPE_DATA frame that goes to the serial port. Only the crc is left
+   * to the serial tx stage, to keep it out of the radio context
+   */
+  struct RxPacket
+  {
+    uint16_t length; /**< frame bytes before the crc */
+    int8_t slot;     /**< reassembler buffer holding a fragmented message's frame, RxReassembler::NONE if in frame */
+    uint8_t frame[LINK_HEADER_LEN + LINK_MAC_LEN + RADIO_MAX_PAYLOAD + LINK_CRC_LEN];
+#if LATENCY_STATS
+    uint32_t stampUs; /**< when onReceive got it */
+#endif
+  };
+
+  static void setup()
+  {
+    Board::begin();
+    HostSerial::begin(HOST_BAUD);
+
+    if (!Radio::template begin<RelayNode>())
+    {
+      Board::led(true);
+      linkLog("ESP-NOW Init Failed");
+      Board::delay(10000);
+      Board::led(false);
+      Board::delay(1000);
+      Board::restart();
+    }
+    if (!Radio::setChannel(RADIO_CHANNEL))
+    {
+      linkLog("Channel refused");
+    }
+    radioChannel = RADIO_CHANNEL;
+    // frames only retune the radio when they ask for other settings than these
+    radioSettings.apply(radioSettings.resolve(RadioHint(), RadioHint()));
+    if (radioSettings.refused != 0)
+    {
+      linkLog("Radio rate or power refused");
+    }
+#if CHANNEL_HOPPING
+    // listen on the control channel for two sync intervals before joining a schedule
+    hopper.begin(Board::micros(), 2 * CHANNEL_SYNC_MS * 1000, Board::random());
+#endif
+    txEngine.addPeer(BROADCAST_ADDRESS);
+    Radio::macAddress(selfMac);
+    // a restarted node must not look like a replay of its old frames
+    txSequence = Board::random();
+
+#if DEBUG
+    uint8_t macAddr[6];
+    char line[32];
+    char macStr[13];
+    Radio::macAddress(macAddr);
+    formatMacAddress(macAddr, macStr);
+    snprintf(line, sizeof(line), "MAC Address: %s", macStr);
+    linkLog(line);
+#endif
+    // the benchmark sends from loop() itself
+#if RELAY_PIPELINE && !TX_BENCHMARK
+    pipelined = P::template startPipeline<RelayNode>();
+#endif
+  }
+
+  static void loop()
+  {
+    Board::template poll<RelayNode>();
+#if TX_BENCHMARK
+    runTxBenchmark();
+    return;
+#endif
+    if (pipelined)
+    {
+      // the stage tasks do the work, the reports included
+      Board::delay(10);
+    }
+    else
+    {
+      runStage(STAGE_SERIAL_TX);
+      runStage(STAGE_SERIAL_RX);
+      runStage(STAGE_RADIO_TX);
+    }
+  }
+
+  /**
+   * @brief Runs one stage of the relay once. The stages only hand work to each
+   * other through single producer, single consumer queues, so each can run in
+   * its own task: serial rx -> hostParser -> radio tx -> radio -> onReceive ->
+   * rxRing -> serial tx
+   *
+   * @return whether the stage did anything, a stage task sleeps when it did not
+   */
+  static bool runStage(PipelineStage stage)
+  {
+    switch (stage)
+    {
+    case STAGE_SERIAL_RX:
+      if (ingestSerial())
+      {
+        P::wake(STAGE_RADIO_TX);
+        return true;
+      }
+      return false;
+    case STAGE_RADIO_TX:
+    {
+      checkBaudDeadline();
+#if RELAY_HOPS
+      queueForwards();
+#endif
+#if CHANNEL_HOPPING
+      uint32_t classes = hop();
+#else
+      uint32_t classes = TX_ALL_CLASSES;
+#endif
+      if (DCC && congestion.due(Board::micros()))
+      {
+        congestion.update(Board::micros(), neighbors.size(Board::millis()));
+      }
+      // without COALESCE a class only holds a frame the queue refused, it goes at once
+      for (uint8_t priority = 0; priority < TX_CLASSES; priority++)
+      {
+        if (!coalescers[priority].empty() &&
+            (!COALESCE || coalescers[priority].age(Board::micros()) >= COALESCE_DEADLINE_US))
+        {
+          flushCoalesced(priority);
+        }
+      }
+      bool worked = queueHostFrames() | pumpTx(classes);
+      report();
+      return worked;
+    }
+    case STAGE_SERIAL_TX:
+      return forwardReceived();
+    default:
+      return false;
+    }
+  }
+
+  /**
+   * @brief A function called whenever the radio recieves a valid Packet
+   * @param macAddr mac address of the sender of the packet
+   * @param data data recieved from the sender of the mentioned above mac address
+   * @param dataLen length of the data recieved
+   * @param rssi signal strength in dBm, RADIO_RSSI_UNKNOWN if the radio does not report it
+   */
+  static void onReceive(const uint8_t *macAddr, const uint8_t *data, int dataLen, int8_t rssi)
+  {
+    // Runs in the radio context: only copy into preallocated slots, the serial tx stage does the slow serial work
+    uint32_t receivedUs = Board::micros();
+    metrics.add(LINK_METRIC_RX_FRAMES);
+    metrics.add(LINK_METRIC_RX_BYTES, dataLen);
+    neighbors.update(macAddr, rssi, dataLen, Board::millis());
+    if (DCC)
+    {
+      // the radio does not say the rate a frame came at, assume the slowest
+      congestion.heard(radioAirtimeUs(dataLen));
+    }
+    if (!airValid(data, dataLen))
+    {
+      metrics.add(LINK_METRIC_RX_INVALID);
+    }
+    else if (airKind(data) == AIR_KIND_SYNC)
+    {
+      // only the time counts, a repeat does no harm
+      if (CHANNEL_HOPPING && dataLen >= AIR_SYNC_LEN)
+      {
+        hopper.heard(airSyncTime(data), receivedUs);
+      }
+    }
+    else if (!airRouted(data))
+    {
+      if (dedup.accept(macAddr, airSequence(data), Board::millis()))
+      {
+        unpackReceived(macAddr, data, dataLen, receivedUs);
+      }
+    }
+    else
+    {
+      // whoever re-aired it, a routed frame is the origin's
+      const uint8_t *origin = airRoute(data, dataLen).origin;
+      if (memcmp(origin, selfMac, 6) == 0)
+      {
+        // our own, back from a neighbour
+      }
+      else if (dedup.accept(origin, airSequence(data), Board::millis()))
+      {
+        unpackReceived(origin, data, dataLen, receivedUs);
+        if (RELAY_HOPS && airRoute(data, dataLen).hopsLeft > 0)
+        {
+          forwards.schedule(data, dataLen, receivedUs + relayBackoffUs(rssi));
+        }
+      }
+      else if (RELAY_HOPS)
+      {
+        forwards.cancel(data, dataLen);
+      }
+    }
+    metrics.raise(LINK_METRIC_RECEIVE_CALLBACK_MAX_US, Board::micros() - receivedUs);
+  }
+
+  /**
+   * @brief A function to call when data is sent
+   *
+   * @param macAddr destination mac address
+   * @param success whether the radio delivered the packet
+   */
+  static void onSent(const uint8_t *macAddr, bool success)
+  {
+    uint32_t calledUs = Board::micros();
+#if LATENCY_STATS
+    uint32_t send = txQueue.onSent();
+    latency[LATENCY_AIR].record(calledUs - txHandedUs[send % TX_WINDOW]);
+#else
+    txQueue.onSent();
+#endif
+    if (!success)
+    {
+      metrics.add(LINK_METRIC_TX_UNCONFIRMED);
+      if (DCC)
+      {
+        congestion.refused();
+      }
+    }
+    P::wake(STAGE_RADIO_TX);
+    metrics.raise(LINK_METRIC_SENT_CALLBACK_MAX_US, Board::micros() - calledUs);
+  }
+
+  /**
+   * @brief Sends a diagnostic message to the host as a LINK_TYPE_LOG frame,
+   * so it never corrupts the binary stream
+   *
+   * @param message null terminated text
+   */
+  static void linkLog(const char *message)
+  {
+    linkSend(LINK_TYPE_LOG, (const uint8_t *)message, strlen(message));
+  }
+
+  /**
+   * @brief Sends a frame to the host. Only setup() and the radio tx stage
+   * call it, the serial tx stage writes the received frames itself
+   *
+   * @param type one of LinkType
+   * @param macAddr mac address the frame is about, nullptr for none
+   */
+  static void linkSend(uint8_t type, const uint8_t *payload, uint16_t length, const uint8_t *macAddr = nullptr)
+  {
+    // one caller at a time, kept off the small stack of a pipeline task
+    static uint8_t frame[LINK_MAX_FRAME];
+    HostSerial::write(frame, linkEncode(frame, type, macAddr, payload, length));
+  }
+
+private:
+  static constexpr uint8_t BROADCAST_ADDRESS[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+  /**
+   * @brief Copies the messages of a new air frame into rxRing, fragments
+   * through the reassembler. Each message is copied once, straight behind
+   * its link header. Radio context
+   */
+  static void unpackReceived(const uint8_t *macAddr, const uint8_t *data, int dataLen, uint32_t receivedUs)
+  {
+    airUnpack(
+        data, dataLen < RADIO_MAX_PAYLOAD ? dataLen : RADIO_MAX_PAYLOAD,
+        [macAddr, receivedUs](const uint8_t *message, size_t length)
+        {
+          RxPacket *packet = rxRing.acquire();
+          if (packet == nullptr)
+          {
+            rxDropped++;
+            return;
+          }
+          size_t header = linkEncodeHeader(packet->frame, LINK_TYPE_DATA, macAddr, length);
+          memcpy(&packet->frame[header], message, length);
+          packet->length = header + length;
+          packet->slot = RxReassembler::NONE;
+          stampReceived(packet, receivedUs);
+          rxRing.commit();
+        },
+        [macAddr, receivedUs](const AirFragment &fragment, const uint8_t *part, size_t length)
+        {
+          int slot = reassembler.add(macAddr, fragment, part, length, Board::millis());
+          if (slot == RxReassembler::NONE)
+          {
+            return;
+          }
+          // the message stays in the reassembler until the serial tx stage has written it
+          RxPacket *packet = rxRing.acquire();
+          if (packet == nullptr)
+          {
+            rxDropped++;
+            reassembler.release(slot);
+            return;
+          }
+          // the header fills the headroom, right in front of the message
+          size_t total = reassembler.length(slot);
+          packet->length = linkEncodeHeader(reassembler.buffer(slot), LINK_TYPE_DATA, macAddr, total) + total;
+          packet->slot = slot;
+          stampReceived(packet, receivedUs);
+          rxRing.commit();
+        });
+    metrics.raise(LINK_METRIC_RX_RING_HIGH, rxRing.size());
+    P::wake(STAGE_SERIAL_TX);
+  }
+
+  /**
+   * @brief Forwards every packet queued by onReceive to the serial port,
+   * so the radio context never blocks on the UART
+   */
+  static bool forwardReceived()
+  {
+    RxPacket *packet;
+    bool forwarded = false;
+    while ((packet = rxRing.front()) != nullptr)
+    {
+      // the frame goes to the serial port from where it was received into
+      uint8_t *frame = packet->slot == RxReassembler::NONE ? packet->frame : reassembler.buffer(packet->slot);
+      HostSerial::write(frame, linkSeal(frame, packet->length));
+      if (packet->slot != RxReassembler::NONE)
+      {
+        reassembler.release(packet->slot);
+      }
+#if LATENCY_STATS
+      latency[LATENCY_RX].record(Board::micros() - packet->stampUs);
+#endif
+      rxRing.pop();
+      stats.forwarded++;
+      forwarded = true;
+    }
+    return forwarded;
+  }
+
+  /**
+   * @brief Moves every complete host frame into the transmit queue
+   *
+   * @return whether a frame was taken
+   */
+  static bool queueHostFrames()
+  {
+    LinkFrame *frame;
+    bool queued = false;
+    while ((frame = hostParser.front()) != nullptr)
+    {
+      if (frame->type == LINK_TYPE_DATA && !queueData(frame))
+      {
+        // TX_BLOCK and its class is full: leave the frame in the parser, serial input backs up
+        break;
+      }
+      if (frame->type == LINK_TYPE_BAUD && frame->length == 4)
+      {
+        handleBaud(frame->payload[0] | frame->payload[1] << 8 | (uint32_t)frame->payload[2] << 16 |
+                   (uint32_t)frame->payload[3] << 24);
+      }
+      else if (frame->type == LINK_TYPE_ECHO)
+      {
+        linkSend(LINK_TYPE_ECHO, frame->payload, frame->length);
+      }
+      else if (frame->type == LINK_TYPE_NEIGHBORS)
+      {
+        sendNeighbors();
+      }
+      else if (frame->type == LINK_TYPE_LATENCY)
+      {
+        sendLatency(frame->length > 0 && (frame->payload[0] & LINK_LATENCY_RESET));
+      }
+      else if (frame->type == LINK_TYPE_RADIO)
+      {
+        handleRadio(frame->payload, frame->length);
+      }
+      else if (frame->type == LINK_TYPE_PEER && (frame->flags & LINK_FLAG_MAC))
+      {
+        handlePeer(frame->macAddr, frame->payload, frame->length);
+      }
+      else if (frame->type == LINK_TYPE_METRICS)
+      {
+        if (frame->length == 4)
+        {
+          metricsPeriodMs = frame->payload[0] | frame->payload[1] << 8 | (uint32_t)frame->payload[2] << 16 |
+                            (uint32_t)frame->payload[3] << 24;
+        }
+        sendMetrics();
+      }
+      hostParser.pop();
+      queued = true;
+    }
+    return queued;
+  }
+
+  /**
+   * @brief Replies to a LINK_TYPE_NEIGHBORS frame with every neighbor heard
+   * within NEIGHBOR_TIMEOUT_MS, a few per frame to keep the stack small
+   */
+  static void sendNeighbors()
+  {
+    const size_t perFrame = 16;
+    LinkNeighbor records[perFrame];
+    uint8_t payload[1 + perFrame * LINK_NEIGHBOR_LEN];
+    size_t from = 0;
+    do
+    {
+      size_t count;
+      from = neighbors.list(from, records, perFrame, &count, Board::millis());
+      // the table may be done with its last slots empty, an empty reply then ends the list
+      payload[0] = from < P::NEIGHBOR_TABLE_SIZE ? LINK_NEIGHBORS_MORE : 0;
+      for (size_t i = 0; i < count; i++)
+      {
+        linkEncodeNeighbor(&payload[1 + i * LINK_NEIGHBOR_LEN], records[i]);
+      }
+      linkSend(LINK_TYPE_NEIGHBORS, payload, 1 + count * LINK_NEIGHBOR_LEN);
+    } while (from < P::NEIGHBOR_TABLE_SIZE);
+  }
+
+  /**
+   * @brief Sends the LINK_TYPE_METRICS block: the relay's own counters plus
+   * the ones its parts already keep
+   */
+  static void sendMetrics()
+  {
+    uint32_t values[LINK_METRICS];
+    for (size_t i = 0; i < LINK_METRICS; i++)
+    {
+      values[i] = metrics.get(i);
+    }
+    values[LINK_METRIC_UPTIME_MS] = Board::millis();
+    values[LINK_METRIC_TX_DROPPED] = txQueue.dropped;
+    values[LINK_METRIC_TX_QUEUE_HIGH] = txQueue.highWater;
+    values[LINK_METRIC_RX_DUPLICATES] = dedup.duplicates;
+    values[LINK_METRIC_RX_DROPPED] = rxDropped;
+    values[LINK_METRIC_REASSEMBLED] = reassembler.completed;
+    values[LINK_METRIC_REASSEMBLY_TIMEOUTS] = reassembler.timedOut;
+    values[LINK_METRIC_REASSEMBLY_DROPPED] = reassembler.evicted + reassembler.dropped;
+    values[LINK_METRIC_HOST_FRAMES] = hostParser.decoded;
+    values[LINK_METRIC_HOST_CRC_ERRORS] = hostParser.crcErrors;
+    values[LINK_METRIC_HOST_SKIPPED_BYTES] = hostParser.droppedBytes;
+    values[LINK_METRIC_SERIAL_FRAMES_OUT] = stats.forwarded;
+    values[LINK_METRIC_RELAY_SCHEDULED] = forwards.scheduled;
+    values[LINK_METRIC_RELAY_FORWARDED] = forwards.forwarded;
+    values[LINK_METRIC_RELAY_CANCELLED] = forwards.cancelled;
+    values[LINK_METRIC_RELAY_DROPPED] = forwards.full;
+    values[LINK_METRIC_CHANNEL] = radioChannel;
+    values[LINK_METRIC_SYNC_SENT] = hopper.beacons;
+    values[LINK_METRIC_SYNC_ADJUSTED] = hopper.adjusted;
+    values[LINK_METRIC_DCC_BUSY] = congestion.busyPermille();
+    values[LINK_METRIC_DCC_SHARE] = congestion.sharePermille();
+    values[LINK_METRIC_DCC_HELD] = congestion.held;
+    values[LINK_METRIC_RADIO_CHANGES] = radioSettings.changes;
+    values[LINK_METRIC_RADIO_REFUSED] = radioSettings.refused;
+    values[LINK_METRIC_PEER_HITS] = txEngine.peers.hits;
+    values[LINK_METRIC_PEER_MISSES] = txEngine.peers.misses;
+    values[LINK_METRIC_PEER_EVICTIONS] = txEngine.peers.evictions;
+
+    uint8_t payload[1 + 4 * LINK_METRICS];
+    payload[0] = LINK_METRICS;
+    for (size_t i = 0; i < LINK_METRICS; i++)
+    {
+      for (int b = 0; b < 4; b++)
+      {
+        payload[1 + 4 * i + b] = values[i] >> (8 * b);
+      }
+    }
+    linkSend(LINK_TYPE_METRICS, payload, sizeof(payload));
+  }
+
+  /**
+   * @brief What the node tells the host unasked, from the radio tx stage
+   * like the replies to its queries
+   */
+  static void report()
+  {
+#if PIPELINE_STATS
+    reportStats();
+#endif
+    pushMetrics();
+
+#if DEBUG
+    static uint32_t lastDropped = 0;
+    if (rxDropped != lastDropped)
+    {
+      char line[32];
+      lastDropped = rxDropped;
+      snprintf(line, sizeof(line), "rx dropped: %u", (unsigned)lastDropped);
+      linkLog(line);
+    }
+#endif
+  }
+
+  /**
+   * @brief Sends the metrics block every metricsPeriodMs, if the host asked for it
+   */
+  static void pushMetrics()
+  {
+    static uint32_t lastPushMs = 0;
+    if (metricsPeriodMs != 0 && Board::millis() - lastPushMs >= metricsPeriodMs)
+    {
+      lastPushMs = Board::millis();
+      sendMetrics();
+    }
+  }
+
+  /**
+   * @brief Replies to a LINK_TYPE_LATENCY frame with one histogram per
+   * stage, or a single empty dump without LATENCY_STATS
+   *
+   * @param reset clear the histograms once sent
+   */
+  static void sendLatency(bool reset)
+  {
+    uint8_t payload[LATENCY_RECORD_LEN];
+#if LATENCY_STATS
+    for (uint8_t stage = 0; stage < LATENCY_STAGES; stage++)
+    {
+      linkSend(LINK_TYPE_LATENCY, payload, latencyEncode(payload, stage, LATENCY_STAGES, latency[stage]));
+      if (reset)
+      {
+        latency[stage].clear();
+      }
+    }
+#else
+    payload[0] = 0;
+    payload[1] = 0;
+    linkSend(LINK_TYPE_LATENCY, payload, 2);
+#endif
+  }
+
+  /**
+   * @brief Board::micros() with LATENCY_STATS, else 0 without reading the clock
+   */
+  static uint32_t latencyStamp()
+  {
+    return LATENCY_STATS ? Board::micros() : 0;
+  }
+
+  static uint32_t stampOf(const LinkFrame *frame)
+  {
+#if LATENCY_STATS
+    return frame->stampUs;
+#else
+    return 0;
+#endif
+  }
+
+  static void stampReceived(RxPacket *packet, uint32_t stampUs)
+  {
+#if LATENCY_STATS
+    packet->stampUs = stampUs;
+#endif
+  }
+
+  /**
+   * @brief Replies to a LINK_TYPE_BAUD frame.
+   *
+   * A proposed rate is acknowledged at the current rate, then the port
+   * switches and waits for the host to repeat the proposal at the new rate.
+   * The repeat is acknowledged and makes the rate stick; without it the port
+   * returns to HOST_BAUD after HOST_BAUD_CONFIRM_MS.
+   *
+   * @param baud rate proposed by the host
+   */
+  static void handleBaud(uint32_t baud)
+  {
+    uint8_t reply[4] = {0, 0, 0, 0};
+    if (baudDeadline != 0 && baud == hostBaud)
+    {
+      // confirmed at the new rate
+      baudDeadline = 0;
+    }
+    else if (baud < HOST_BAUD || baud > HOST_MAX_BAUD)
+    {
+      linkSend(LINK_TYPE_BAUD, reply, sizeof(reply));
+      return;
+    }
+    for (int i = 0; i < 4; i++)
+    {
+      reply[i] = baud >> (8 * i);
+    }
+    linkSend(LINK_TYPE_BAUD, reply, sizeof(reply));
+    if (baud != hostBaud)
+    {
+      HostSerial::flush();
+      HostSerial::setBaud(baud);
+      hostBaud = baud;
+      baudDeadline = Board::millis() + HOST_BAUD_CONFIRM_MS;
+      // 0 means no negotiation pending
+      baudDeadline += baudDeadline == 0;
+    }
+  }
+
+  /**
+   * @brief Falls back to HOST_BAUD when the host never confirmed the new rate
+   */
+  static void checkBaudDeadline()
+  {
+    if (baudDeadline != 0 && (int32_t)(Board::millis() - baudDeadline) >= 0)
+    {
+      baudDeadline = 0;
+      hostBaud = HOST_BAUD;
+      HostSerial::setBaud(HOST_BAUD);
+    }
+  }
+
+  /**
+   * @brief Reports a failed send to the host, kept off the send path
+   *
+   * @param result Radio::send return value
+   */
+  static void reportSendError(RadioStatus result)
+  {
+    if (result == RADIO_NOT_INIT)
+    {
+      linkLog("ESP-NOW not Init.");
+    }
+    else if (result == RADIO_ARG)
+    {
+      linkLog("Invalid Argument");
+    }
+    else if (result == RADIO_INTERNAL)
+    {
+      linkLog("Internal Error");
+    }
+    else if (result == RADIO_NO_MEM)
+    {
+      linkLog("ESP_ERR_ESPNOW_NO_MEM");
+    }
+    else if (result == RADIO_NOT_FOUND)
+    {
+      linkLog("Peer not found.");
+    }
+    else
+    {
+      linkLog("Unknown error");
+    }
+  }
+
+  /**
+   * @brief how long to wait before re-airing a frame heard at rssi: the
+   * weaker the signal, the farther the sender and the more new ground a
+   * re-air covers, so the shorter the wait
+   */
+  static uint32_t relayBackoffUs(int8_t rssi)
+  {
+    const int32_t span = RELAY_RSSI_NEAR - RELAY_RSSI_FAR;
+    int32_t nearness = rssi == RADIO_RSSI_UNKNOWN ? span / 2 : rssi - RELAY_RSSI_FAR;
+    nearness = nearness < 0 ? 0 : nearness > span ? span : nearness;
+    return (uint32_t)RELAY_BACKOFF_US * nearness / span + Board::random() % (RELAY_JITTER_US + 1);
+  }
+
+  /**
+   * @brief Queues the frames of others whose backoff is over, in their origin's class
+   */
+  static void queueForwards()
+  {
+    forwards.take(Board::micros(), [](const uint8_t *frame, size_t length)
+    { txQueue.enqueue(BROADCAST_ADDRESS, frame, length, airRoute(frame, length).priority, latencyStamp()); });
+  }
+
+  /**
+   * @brief Tunes the radio to the channel of the current slot and queues a
+   * sync frame, in the most urgent class, when one is due
+   *
+   * @return classes that may send now: the most urgent one in the control
+   * part, the others in the service part, none close to a switch. A single
+   * class sends in both parts
+   */
+  static uint32_t hop()
+  {
+    uint32_t nowUs = Board::micros();
+    ChannelSlot slot = hopper.slot(nowUs);
+    if (slot.channel != radioChannel && Radio::setChannel(slot.channel))
+    {
+      radioChannel = slot.channel;
+      metrics.add(LINK_METRIC_CHANNEL_SWITCHES);
+    }
+    if (hopper.beaconDue(nowUs, Board::random()))
+    {
+      // the time is stamped by pumpTx(), right before the send
+      uint8_t frame[AIR_SYNC_LEN] = {airHeader(AIR_KIND_SYNC)};
+      txQueue.enqueue(BROADCAST_ADDRESS, frame, sizeof(frame), 0, latencyStamp());
+    }
+    if (slot.quiet)
+    {
+      return 0;
+    }
+    return slot.control ? 1 : TX_CLASSES == 1 ? TX_ALL_CLASSES : TX_ALL_CLASSES & ~1u;
+  }
+
+  /**
+   * @brief transmit class of a host frame, priorities past the last class share it
+   */
+  static uint8_t classOf(uint8_t flags)
+  {
+    uint8_t priority = linkPriority(flags);
+    return priority < TX_CLASSES ? priority : TX_CLASSES - 1;
+  }
+
+  /**
+   * @brief Broadcasts the message of a LINK_TYPE_DATA frame, or sends it to
+   * the frame's mac address, less the radio hint in front of it if the frame
+   * has one
+   *
+   * @return false if the class is full under TX_BLOCK, see broadcast()
+   */
+  static bool queueData(const LinkFrame *frame)
+  {
+    RadioHint radio = RadioHint();
+    size_t offset = 0;
+    if ((frame->flags & LINK_FLAG_RADIO) && frame->length >= LINK_RADIO_HINT_LEN)
+    {
+      radio = RadioSettings<Radio>::valid({frame->payload[0], frame->payload[1]});
+      offset = LINK_RADIO_HINT_LEN;
+    }
+    if (frame->flags & LINK_FLAG_MAC)
+    {
+      return unicast(frame->macAddr, &frame->payload[offset], frame->length - offset, classOf(frame->flags),
+                     stampOf(frame), radio);
+    }
+    return broadcast(&frame->payload[offset], frame->length - offset, classOf(frame->flags), stampOf(frame), radio);
+  }
+
+  /**
+   * @brief Sets or removes the key of a unicast peer for a LINK_TYPE_PEER
+   * frame and tells the host whether it took
+   *
+   * @param lmk LINK_PEER_KEY_LEN bytes, length 0 to remove the key
+   */
+  static void handlePeer(const uint8_t *macAddr, const uint8_t *lmk, size_t length)
+  {
+    uint8_t accepted = (length == 0 || length == LINK_PEER_KEY_LEN) &&
+                       memcmp(macAddr, BROADCAST_ADDRESS, 6) != 0 &&
+                       txEngine.setKey(macAddr, length == 0 ? nullptr : lmk);
+    linkSend(LINK_TYPE_PEER, &accepted, 1, macAddr);
+  }
+
+  /**
+   * @brief Takes the radio hints of a LINK_TYPE_RADIO frame for the first
+   * classes and replies with those of every class
+   */
+  static void handleRadio(const uint8_t *hints, size_t length)
+  {
+    for (size_t i = 0; i < LINK_PRIORITIES && (i + 1) * LINK_RADIO_HINT_LEN <= length; i++)
+    {
+      classRadio[i] = RadioSettings<Radio>::valid({hints[2 * i], hints[2 * i + 1]});
+    }
+    uint8_t reply[LINK_PRIORITIES * LINK_RADIO_HINT_LEN];
+    for (size_t i = 0; i < LINK_PRIORITIES; i++)
+    {
+      reply[2 * i] = classRadio[i].rate;
+      reply[2 * i + 1] = classRadio[i].power;
+    }
+    linkSend(LINK_TYPE_RADIO, reply, sizeof(reply));
+  }
+
+  /**
+   * @brief Broadcast a message to all Surrounders,
+   * Sends message to FF:FF:FF:FF:FF:FF *a psuedo broadcast*
+   * The message is packed into an air frame, queued in its class and sent by pumpTx()
+   *
+   * @param message information to be sent to every device
+   * @param priority transmit class, see classOf()
+   * @param stampUs when the host frame was complete, for LATENCY_STATS
+   * @param radio rate and power the message asks for, zeros for its class's
+   * @return false if the class is full under TX_BLOCK, the caller keeps the message
+   */
+  static bool broadcast(const uint8_t *message, int length, uint8_t priority, uint32_t stampUs,
+                        RadioHint radio = RadioHint())
+  {
+    if (length > (int)(TX_MAX_FRAME - AIR_HEADER_LEN))
+    {
+      return queueFragments(BROADCAST_ADDRESS, message, length, priority, stampUs, radio);
+    }
+    // only messages of the same class and radio hint share a frame
+    TxCoalescer &coalescer = coalescers[priority];
+    bool sameRadio = coalescedRadio[priority].rate == radio.rate && coalescedRadio[priority].power == radio.power;
+    if ((!COALESCE || !coalescer.fits(length) || !sameRadio) && !flushCoalesced(priority))
+    {
+      return false;
+    }
+    // without coalescing the message is queued alone right away: a full class
+    // refuses it here rather than holding it in the coalescer for later ones
+    if (!COALESCE && TX_DROP_POLICY == TX_BLOCK && txQueue.space(priority) == 0)
+    {
+      return false;
+    }
+    if (coalescer.empty())
+    {
+      coalescedRadio[priority] = radio;
+#if LATENCY_STATS
+      coalescedStampUs[priority] = stampUs;
+#endif
+    }
+    coalescer.add(message, length, Board::micros());
+    if (!COALESCE || coalescer.size() >= COALESCE_THRESHOLD)
+    {
+      // under TX_BLOCK a full class keeps the bundle here for the next try
+      flushCoalesced(priority);
+    }
+    return true;
+  }
+
+  /**
+   * @brief Sends a message to one node, after anything being coalesced in
+   * its class so the messages keep their order. The radio confirms the
+   * frame, it is neither coalesced nor re-aired
+   *
+   * @return false if the class is full under TX_BLOCK, the caller keeps the message
+   */
+  static bool unicast(const uint8_t *macAddr, const uint8_t *message, size_t length, uint8_t priority,
+                      uint32_t stampUs, RadioHint radio)
+  {
+    if (length > TX_MAX_FRAME - AIR_HEADER_LEN)
+    {
+      return queueFragments(macAddr, message, length, priority, stampUs, radio);
+    }
+    if (!flushCoalesced(priority))
+    {
+      return false;
+    }
+    uint8_t frame[AIR_MAX_FRAME] = {airHeader(AIR_KIND_SINGLE)};
+    memcpy(&frame[AIR_HEADER_LEN], message, length);
+    if (!txQueue.enqueue(macAddr, frame, AIR_HEADER_LEN + length, priority, latencyStamp(), radio))
+    {
+      return false;
+    }
+#if LATENCY_STATS
+    latency[LATENCY_HOST].record(Board::micros() - stampUs);
+#endif
+    return true;
+  }
+
+  /**
+   * @brief Queues a message longer than one radio frame as numbered fragments,
+   * after anything being coalesced so the messages keep their order
+   *
+   * @param macAddr destination, BROADCAST_ADDRESS for every node
+   * @return false if the class cannot take every fragment under TX_BLOCK, nothing was queued
+   */
+  static bool queueFragments(const uint8_t *macAddr, const uint8_t *message, size_t length, uint8_t priority,
+                             uint32_t stampUs, RadioHint radio)
+  {
+    AirFragment fragment = {txMessageId, 0, (uint8_t)((length + TX_FRAGMENT - 1) / TX_FRAGMENT), TX_FRAGMENT};
+    if (!flushCoalesced(priority) || (TX_DROP_POLICY == TX_BLOCK && txQueue.space(priority) < fragment.count))
+    {
+      return false;
+    }
+    uint8_t frame[AIR_MAX_FRAME];
+    for (; fragment.index < fragment.count; fragment.index++)
+    {
+      size_t offset = (size_t)fragment.index * TX_FRAGMENT;
+      size_t part = length - offset < TX_FRAGMENT ? length - offset : TX_FRAGMENT;
+      airFragmentHeader(frame, fragment);
+      memcpy(&frame[AIR_FRAGMENT_HEADER_LEN], &message[offset], part);
+      txQueue.enqueue(macAddr, frame, AIR_FRAGMENT_HEADER_LEN + part, priority, latencyStamp(), radio);
+    }
+#if LATENCY_STATS
+    latency[LATENCY_HOST].record(Board::micros() - stampUs);
+#endif
+    txMessageId++;
+    return true;
+  }
+
+  /**
+   * @brief Queues the frame being coalesced in a class
+   *
+   * @return false if the class is full under TX_BLOCK, the frame is kept
+   */
+  static bool flushCoalesced(uint8_t priority)
+  {
+    TxCoalescer &coalescer = coalescers[priority];
+    if (coalescer.empty())
+    {
+      return true;
+    }
+    if (!txQueue.enqueue(BROADCAST_ADDRESS, coalescer.data(), coalescer.size(), priority, latencyStamp(),
+                         coalescedRadio[priority]))
+    {
+      return false;
+    }
+#if LATENCY_STATS
+    // a bundle counts once, from its first message
+    latency[LATENCY_HOST].record(Board::micros() - coalescedStampUs[priority]);
+#endif
+    coalescer.clear();
+    return true;
+  }
+
+  /**
+   * @brief Hands queued packets to the radio while the in-flight window has room,
+   * a packet refused for lack of buffers stays queued for the next pass
+   *
+   * The sequence number is stamped here rather than when queued: the
+   * classes reorder frames, receivers should still see them numbered in
+   * the order they were sent. Frames re-aired for others keep their
+   * origin's number, own broadcasts get their route here under RELAY_HOPS.
+   * Sync frames get the network time here, as late as possible. Under DCC
+   * the token bucket holds back everything else, sync frames keep the
+   * schedule going whatever the load. The radio is tuned to the frame's
+   * rate and power only once it is sure to go.
+   *
+   * @param classes classes that may send now, see hop()
+   * @return whether a packet was handed to the radio
+   */
+  static bool pumpTx(uint32_t classes)
+  {
+    size_t sent = txQueue.pump([](TxPacket &packet) -> TxSendResult
+    {
+      Board::led(true);
+      // a retried frame of our own already has its route
+      bool own = !airRouted(packet.data) || memcmp(airRoute(packet.data, packet.length).origin, selfMac, 6) == 0;
+      if (own)
+      {
+        airSetSequence(packet.data, txSequence);
+      }
+      bool sync = airKind(packet.data) == AIR_KIND_SYNC;
+      if (sync)
+      {
+        airSetSyncTime(packet.data, hopper.networkUs(Board::micros()));
+      }
+#if RELAY_HOPS
+      // unicast frames are for one node, nobody re-airs them
+      if (!airRouted(packet.data) && !sync && memcmp(packet.macAddr, BROADCAST_ADDRESS, 6) == 0)
+      {
+        packet.length = airAddRoute(packet.data, packet.length, selfMac, RELAY_HOPS, packet.priority);
+      }
+#endif
+      // counted as dcc_held once the frame goes, the queue only counts the radio's refusals
+      if (DCC && !sync && !congestion.ready(Board::micros()))
+      {
+        Board::led(false);
+        return TX_HOLD;
+      }
+      uint8_t hinted = packet.priority < LINK_PRIORITIES ? packet.priority : LINK_PRIORITIES - 1;
+      RadioHint radio = radioSettings.resolve(packet.radio, classRadio[hinted]);
+      radioSettings.apply(radio);
+#if LATENCY_STATS
+      // before the send, its callback may come before send() returns
+      uint32_t handedUs = Board::micros();
+      txHandedUs[txQueue.nextSend() % TX_WINDOW] = handedUs;
+#endif
+      RadioStatus result = txEngine.send(packet.macAddr, packet.data, packet.length);
+      metrics.add(LINK_METRIC_TX_OK + result);
+      if (result == RADIO_OK)
+      {
+        Board::led(false);
+        txSequence += own;
+        if (DCC)
+        {
+          congestion.sent(radioAirtimeUs(packet.length, radio.rate));
+        }
+#if LATENCY_STATS
+        latency[LATENCY_TX_QUEUE].record(handedUs - packet.stampUs);
+#endif
+        return TX_SENT;
+      }
+      if (result == RADIO_NO_MEM)
+      {
+        if (DCC)
+        {
+          congestion.refused();
+        }
+        return TX_RETRY;
+      }
+#if DEBUG
+      // counted in the metrics either way, a log line per failure only while debugging
+      reportSendError(result);
+#endif
+      return TX_FAILED;
+    }, classes);
+    stats.sent += sent;
+    return sent > 0;
+  }
+
+  /**
+   * @brief Moves every byte already waiting on the serial port into hostParser,
+   * never waits for more bytes to arrive
+   *
+   * @return whether a new frame became available
+   */
+  static bool ingestSerial()
+  {
+    uint8_t chunk[64];
+    size_t available;
+    size_t wanted;
+    uint32_t before = hostParser.decoded;
+    // wanted() also decodes a frame that was waiting for a free slot
+    while ((wanted = hostParser.wanted()) > 0 && (available = HostSerial::available()) > 0)
+    {
+      size_t length = available < wanted ? available : wanted;
+      length = HostSerial::read(chunk, length < sizeof(chunk) ? length : sizeof(chunk));
+      hostParser.feed(chunk, length, latencyStamp());
+    }
+    stats.framesIn = hostParser.decoded;
+    metrics.raise(LINK_METRIC_HOST_QUEUE_HIGH, hostParser.queued());
+    return hostParser.decoded != before;
+  }
+
+#if PIPELINE_STATS
+  /**
+   * @brief Logs the depth of each stage queue and the frames per second
+   * through each stage every PIPELINE_STATS ms
+   */
+  static void reportStats()
+  {
+    static uint32_t windowStart = Board::millis();
+    static Stats last = {};
+
+    uint32_t elapsed = Board::millis() - windowStart;
+    if (elapsed < PIPELINE_STATS)
+    {
+      return;
+    }
+    char line[112];
+    snprintf(line, sizeof(line), "%s in=%u/s [%u] tx=%u/s [%u] fwd=%u/s [%u]", pipelined ? "pipeline" : "loop",
+             (unsigned)((stats.framesIn - last.framesIn) * 1000 / elapsed), (unsigned)hostParser.queued(),
+             (unsigned)((stats.sent - last.sent) * 1000 / elapsed), (unsigned)txQueue.size(),
+             (unsigned)((stats.forwarded - last.forwarded) * 1000 / elapsed), (unsigned)rxRing.size());
+    linkLog(line);
+    last.framesIn = stats.framesIn;
+    last.sent = stats.sent;
+    last.forwarded = stats.forwarded;
+    windowStart = Board::millis();
+  }
+#endif
+
+#if TX_BENCHMARK
+  /**
+   * @brief Sends full size broadcasts as fast as the radio accepts them
+   * and logs the number of accepted and refused sends every second
+   */
+  static void runTxBenchmark()
+  {
+    static uint8_t payload[RADIO_MAX_PAYLOAD];
+    static uint32_t windowStart = Board::millis();
+    static uint32_t ok = 0;
+    static uint32_t failed = 0;
+
+#if TX_BENCHMARK == 2
+    Radio::benchmarkPeerSetup(BROADCAST_ADDRESS);
+#endif
+    if (txEngine.send(BROADCAST_ADDRESS, payload, sizeof(payload)) == RADIO_OK)
+    {
+      ok++;
+    }
+    else
+    {
+      failed++;
+    }
+
+    if (Board::millis() - windowStart >= 1000)
+    {
+      char line[48];
+      snprintf(line, sizeof(line), "tx/s ok=%u failed=%u", (unsigned)ok, (unsigned)failed);
+      linkLog(line);
+      windowStart = Board::millis();
+      ok = 0;
+      failed = 0;
+    }
+  }
+#endif
+
+  /**
+   * @brief Frames through each stage, each counter written by one stage only
+   */
+  struct Stats
+  {
+    volatile uint32_t framesIn;  /**< host frames decoded by serial rx */
+    volatile uint32_t sent;      /**< packets handed to the radio by radio tx */
+    volatile uint32_t forwarded; /**< packets written to the host by serial tx */
+  };
+
+  // current host link rate, and when it falls back to HOST_BAUD unless confirmed (0: not pending)
+  static uint32_t hostBaud;
+  static uint32_t baudDeadline;
+
+  // true once the stages run in their own tasks
+  static bool pipelined;
+  static Stats stats;
+  // LINK_TYPE_METRICS counters not kept elsewhere, bumped from any context
+  static MetricCounters<LINK_METRICS> metrics;
+  // push period, set from a LINK_TYPE_METRICS request, read by loop()
+  static volatile uint32_t metricsPeriodMs;
+
+  // filled by onReceive (radio context), drained by the serial tx stage
+  static SpscRing<RxPacket, P::RX_RING_SIZE> rxRing;
+  static volatile uint32_t rxDropped;
+
+  // filled from host frames and drained into the radio by the radio tx stage, slots released by onSent
+  static TxQueue<P::TX_QUEUE_DEPTH, TX_CLASSES> txQueue;
+  static const uint8_t txWeights[LINK_PRIORITIES];
+  static TxEngine<Radio, P::PEER_KEYS> txEngine;
+  // host messages waiting to share a radio frame, one per class, only used by the radio tx stage
+  typedef Coalescer<TX_MAX_FRAME> TxCoalescer;
+  static TxCoalescer coalescers[TX_CLASSES];
+  // radio hint of the messages in each coalesced frame
+  static RadioHint coalescedRadio[TX_CLASSES];
+  // id of the next fragmented message and sequence number of the next air frame
+  static uint8_t txMessageId;
+  static uint16_t txSequence;
+
+  // fragmented messages being received, filled by onReceive, released by the serial tx stage
+  static RxReassembler reassembler;
+  // recent sequence numbers of every sender, only used by onReceive
+  static DedupTable<P::DEDUP_TABLE_SIZE> dedup;
+  // who is around, updated by onReceive, listed for the host by the radio tx stage
+  static NeighborTable<P::NEIGHBOR_TABLE_SIZE> neighbors;
+  // frames of others waiting to be re-aired, scheduled by onReceive, queued by the radio tx stage
+  static ForwardTable<RELAY_HOPS ? P::FORWARD_SLOTS : 1> forwards;
+  static uint8_t selfMac[6];
+  // channel schedule, slots taken by the radio tx stage, sync frames heard by onReceive
+  static Hopper hopper;
+  static volatile uint8_t radioChannel;
+  // share of the air under DCC, frames heard and refused sends counted by the radio callbacks
+  static CongestionControl congestion;
+  static RadioSettings<Radio> radioSettings;
+  // LINK_TYPE_RADIO hint of each class, set and read by the radio tx stage
+  static RadioHint classRadio[LINK_PRIORITIES];
+
+  static LinkParser<HOST_QUEUE_SIZE> hostParser;
+
+#if LATENCY_STATS
+  // one histogram per LatencyStage, each written by one stage or callback
+  static LatencyHistogram latency[LATENCY_STAGES];
+  // when each in-flight send was handed to the radio, by send number
+  static uint32_t txHandedUs[TX_WINDOW];
+  // when the first message of each class's coalesced frame was complete
+  static uint32_t coalescedStampUs[TX_CLASSES];
+#endif
+};
+
+template <typename P>
+constexpr uint8_t RelayNode<P>::BROADCAST_ADDRESS[6];
+template <typename P>
+uint32_t RelayNode<P>::hostBaud = HOST_BAUD;
+template <typename P>
+uint32_t RelayNode<P>::baudDeadline = 0;
+template <typename P>
+bool RelayNode<P>::pipelined = false;
+template <typename P>
+typename RelayNode<P>::Stats RelayNode<P>::stats = {};
+template <typename P>
+MetricCounters<LINK_METRICS> RelayNode<P>::metrics;
+template <typename P>
+volatile uint32_t RelayNode<P>::metricsPeriodMs = METRICS_PERIOD_MS;
+template <typename P>
+SpscRing<typename RelayNode<P>::RxPacket, P::RX_RING_SIZE> RelayNode<P>::rxRing;
+template <typename P>
+volatile uint32_t RelayNode<P>::rxDropped = 0;
+template <typename P>
+const uint8_t RelayNode<P>::txWeights[LINK_PRIORITIES] = {TX_WEIGHTS};
+template <typename P>
+TxQueue<P::TX_QUEUE_DEPTH, TX_CLASSES> RelayNode<P>::txQueue(TX_DROP_POLICY, TX_WINDOW, TX_SCHEDULE, txWeights);
+template <typename P>
+TxEngine<typename P::Radio, P::PEER_KEYS> RelayNode<P>::txEngine;
+template <typename P>
+typename RelayNode<P>::TxCoalescer RelayNode<P>::coalescers[TX_CLASSES];
+template <typename P>
+RadioHint RelayNode<P>::coalescedRadio[TX_CLASSES];
+template <typename P>
+uint8_t RelayNode<P>::txMessageId = 0;
+template <typename P>
+uint16_t RelayNode<P>::txSequence = 0;
+template <typename P>
+typename RelayNode<P>::RxReassembler RelayNode<P>::reassembler(REASSEMBLY_TIMEOUT_MS);
+template <typename P>
+DedupTable<P::DEDUP_TABLE_SIZE> RelayNode<P>::dedup(DEDUP_TIMEOUT_MS);
+template <typename P>
+NeighborTable<P::NEIGHBOR_TABLE_SIZE> RelayNode<P>::neighbors(NEIGHBOR_TIMEOUT_MS);
+template <typename P>
+ForwardTable<RELAY_HOPS ? P::FORWARD_SLOTS : 1> RelayNode<P>::forwards;
+template <typename P>
+uint8_t RelayNode<P>::selfMac[6];
+template <typename P>
+constexpr uint8_t RelayNode<P>::SERVICE_CHANNEL_LIST[];
+template <typename P>
+typename RelayNode<P>::Hopper RelayNode<P>::hopper(RADIO_CHANNEL, SERVICE_CHANNEL_LIST, CHANNEL_SYNC_MS * 1000,
+                                                   CHANNEL_CONTROL_MS * 1000, CHANNEL_GUARD_US, CHANNEL_RESCAN);
+template <typename P>
+volatile uint8_t RelayNode<P>::radioChannel = RADIO_CHANNEL;
+template <typename P>
+CongestionControl RelayNode<P>::congestion(DCC_PERIOD_MS * 1000, DCC_TARGET, DCC_MIN_SHARE, DCC_MAX_SHARE, DCC_DECAY,
+                                           DCC_GAIN, DCC_BURST_US);
+template <typename P>
+RadioSettings<typename P::Radio> RelayNode<P>::radioSettings({RADIO_RATE, RADIO_TX_POWER});
+template <typename P>
+RadioHint RelayNode<P>::classRadio[LINK_PRIORITIES];
+template <typename P>
+LinkParser<HOST_QUEUE_SIZE> RelayNode<P>::hostParser;
+#if LATENCY_STATS
+template <typename P>
+LatencyHistogram RelayNode<P>::latency[LATENCY_STAGES];
+template <typename P>
+uint32_t RelayNode<P>::txHandedUs[TX_WINDOW];
+template <typename P>
+uint32_t RelayNode<P>::coalescedStampUs[TX_CLASSES];
+#endif
+
+#endif
@@ -0,0 +1,124 @@
+#ifndef __SPSC_RING_H__
+#define __SPSC_RING_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+/**
+ * @brief Fixed capacity single-producer/single-consumer ring of preallocated slots
+ *
+ * The producer (e.g. the ESP-NOW receive callback) claims a slot with acquire(),
+ * fills it in place and publishes it with commit(). The consumer (e.g. loop())
+ * reads the oldest slot with front() and hands it back with pop().
+ * No locks and no heap: the only shared state is one atomic index per side.
+ *
+ * @tparam T slot type, copied in place, never constructed/destroyed per push
+ * @tparam Capacity number of slots, must be a power of two
+ */
+template <typename T, size_t Capacity>
+class SpscRing
+{
+  static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "SpscRing capacity must be a power of two");
+
+public:
+  SpscRing() : head(0), tail(0) {}
+
+  /**
+   * @brief producer side: get the next free slot without publishing it
+   *
+   * @return pointer to the slot to fill, nullptr if the ring is full
+   */
+  T *acquire()
+  {
+    const uint32_t h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) == Capacity)
+    {
+      return nullptr;
+    }
+    return &slots[h & (Capacity - 1)];
+  }
+
+  /**
+   * @brief producer side: publish the slot returned by the last acquire()
+   */
+  void commit()
+  {
+    head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+  /**
+   * @brief consumer side: get the oldest published slot without releasing it
+   *
+   * @return pointer to the slot, nullptr if the ring is empty
+   */
+  T *front()
+  {
+    const uint32_t t = tail.load(std::memory_order_relaxed);
+    if (head.load(std::memory_order_acquire) == t)
+    {
+      return nullptr;
+    }
+    return &slots[t & (Capacity - 1)];
+  }
+
+  /**
+   * @brief consumer side: hand the slot returned by front() back to the producer
+   */
+  void pop()
+  {
+    tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+  /**
+   * @brief copy an item in, convenience wrapper over acquire()/commit()
+   *
+   * @return false if the ring is full
+   */
+  bool push(const T &item)
+  {
+    T *slot = acquire();
+    if (slot == nullptr)
+    {
+      return false;
+    }
+    *slot = item;
+    commit();
+    return true;
+  }
+
+  /**
+   * @brief copy an item out, convenience wrapper over front()/pop()
+   *
+   * @return false if the ring is empty
+   */
+  bool pop(T &item)
+  {
+    T *slot = front();
+    if (slot == nullptr)
+    {
+      return false;
+    }
+    item = *slot;
+    pop();
+    return true;
+  }
+
+  /**
+   * @brief number of published slots, exact only when called from either side
+   */
+  size_t size() const
+  {
+    return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+  }
+
+  static constexpr size_t capacity() { return Capacity; }
+
+private:
+  T slots[Capacity];
+  // free running indices, wrap-around is handled by unsigned arithmetic
+  std::atomic<uint32_t> head;
+  std::atomic<uint32_t> tail;
+};
+
+#endif
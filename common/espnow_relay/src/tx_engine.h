@@ -0,0 +1,55 @@
+#ifndef __TX_ENGINE_H__
+#define __TX_ENGINE_H__
+
+#include <stdint.h>
+#include <string.h>
+#include "hal.h"
+#include "peer_cache.h"
+
+/**
+ * @brief Owns radio peer setup so sending a packet is only Radio::send,
+ * peers are registered on their first send and kept in a PeerCache
+ *
+ * @tparam Radio the platform's radio, see hal.h
+ * @tparam Keys peers that can have a key, see PeerCache
+ */
+template <typename Radio, size_t Keys>
+class TxEngine
+{
+public:
+  /**
+   * @brief registers a peer for good, e.g. the broadcast address
+   *
+   * @return false if the radio refused the peer
+   */
+  bool addPeer(const uint8_t *macAddr)
+  {
+    return peers.pin(macAddr);
+  }
+
+  /**
+   * @brief sets or removes (lmk nullptr) the key of a unicast peer
+   */
+  bool setKey(const uint8_t *macAddr, const uint8_t *lmk)
+  {
+    return peers.setKey(macAddr, lmk);
+  }
+
+  /**
+   * @brief hands a packet to the radio, registering its destination first if needed
+   *
+   * @return RADIO_NOT_FOUND if the destination could not be registered
+   */
+  RadioStatus send(const uint8_t *macAddr, const uint8_t *data, size_t length)
+  {
+    if (!peers.acquire(macAddr))
+    {
+      return RADIO_NOT_FOUND;
+    }
+    return Radio::send(macAddr, data, length);
+  }
+
+  PeerCache<Radio, Keys, RADIO_MAX_PEERS, RADIO_MAX_ENCRYPTED_PEERS> peers;
+};
+
+#endif
@@ -0,0 +1,310 @@
+#ifndef __TX_QUEUE_H__
+#define __TX_QUEUE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include "radio_settings.h"
+
+#define TX_MAX_PACKET 250
+#define TX_ALL_CLASSES 0xFFFFFFFF
+
+/**
+ * @brief What to do with a new packet when the queue is full
+ */
+enum TxDropPolicy
+{
+  TX_DROP_OLDEST, /**< discard the oldest queued packet to make room */
+  TX_DROP_NEWEST, /**< discard the new packet */
+  TX_BLOCK,       /**< refuse the new packet, the caller keeps it and tries again later */
+};
+
+/**
+ * @brief Outcome of handing one packet to the radio
+ */
+enum TxSendResult
+{
+  TX_SENT,   /**< accepted, a send completion will follow */
+  TX_RETRY,  /**< radio out of buffers, keep the packet and try again later */
+  TX_HOLD,   /**< not to send yet, e.g. held by congestion control: keep the packet, not a retry */
+  TX_FAILED, /**< rejected for good, the packet is dropped */
+};
+
+/**
+ * @brief How pump() picks the class of the next packet
+ */
+enum TxSchedule
+{
+  TX_STRICT,   /**< always the most urgent class with a packet, lower classes wait */
+  TX_WEIGHTED, /**< deficit round robin: each class gets airtime in proportion to its weight */
+};
+
+/**
+ * @brief A packet waiting in TxQueue
+ */
+struct TxPacket
+{
+  uint8_t macAddr[6];
+  uint8_t length;
+  uint8_t priority; /**< as given to enqueue(), the class is this or the last one */
+  RadioHint radio;  /**< the frame's own rate and power, zeros for the class's */
+  uint8_t data[TX_MAX_PACKET];
+#if defined(LATENCY_STATS) && LATENCY_STATS
+  uint32_t stampUs; /**< when it was queued */
+#endif
+};
+
+/**
+ * @brief Bounded transmit queue per priority class with an in-flight window
+ *
+ * enqueue() and pump() are called from the same context (loop()), onSent()
+ * is called from the send completion callback and only bumps an atomic
+ * counter. pump() hands packets to the radio while fewer than `window` are
+ * in flight, so the radio is never flooded past what it can buffer.
+ * Has no hardware dependency: the radio is whatever callable is given to pump().
+ *
+ * Class 0 is the most urgent. Each class has its own ring of Depth packets
+ * and the drop policy applies per class, so bulk traffic filling its ring
+ * never pushes out an urgent packet. Packets of one class leave in order.
+ *
+ * @tparam Depth number of queued packets per class
+ * @tparam Classes number of priority classes
+ */
+template <size_t Depth, size_t Classes = 1>
+class TxQueue
+{
+public:
+  /**
+   * @param weights share of each class under TX_WEIGHTED, at least 1, nullptr for equal shares
+   */
+  TxQueue(TxDropPolicy policy, uint8_t window, TxSchedule schedule = TX_STRICT, const uint8_t *weights = nullptr)
+      : enqueued(0), dropped(0), retried(0), failed(0), highWater(0),
+        policy(policy), window(window), schedule(schedule), current(0), count(0), submitted(0), completed(0)
+  {
+    for (size_t i = 0; i < Classes; i++)
+    {
+      lanes[i].head = 0;
+      lanes[i].count = 0;
+      lanes[i].deficit = 0;
+      // one quantum lets a class send at least one full packet per round
+      lanes[i].quantum = (weights != nullptr && weights[i] > 0 ? weights[i] : 1) * TX_MAX_PACKET;
+    }
+  }
+
+  /**
+   * @brief copy a packet into the queue of its class
+   *
+   * @param priority class, 0 is the most urgent, larger values go to the last class
+   * @param stampUs time of the call, kept in the packet under LATENCY_STATS
+   * @param radio rate and power the frame asks for, kept in the packet
+   * @return false only under TX_BLOCK with a full class, the caller keeps the packet
+   * and tries again later. true once the queue took the packet over, even if
+   * the drop policy or an oversized length discarded it
+   */
+  bool enqueue(const uint8_t *macAddr, const uint8_t *data, size_t length, uint8_t priority = 0, uint32_t stampUs = 0,
+               RadioHint radio = RadioHint())
+  {
+    if (length > TX_MAX_PACKET)
+    {
+      failed++;
+      return true;
+    }
+    Lane &lane = lanes[priority < Classes ? priority : Classes - 1];
+    if (lane.count == Depth)
+    {
+      if (policy == TX_BLOCK)
+      {
+        return false;
+      }
+      dropped++;
+      if (policy == TX_DROP_NEWEST)
+      {
+        return true;
+      }
+      lane.head = (lane.head + 1) % Depth;
+      lane.count--;
+      count--;
+    }
+
+    TxPacket &packet = lane.packets[(lane.head + lane.count) % Depth];
+    memcpy(packet.macAddr, macAddr, 6);
+    packet.length = length;
+    packet.priority = priority;
+    packet.radio = radio;
+    memcpy(packet.data, data, length);
+#if defined(LATENCY_STATS) && LATENCY_STATS
+    packet.stampUs = stampUs;
+#endif
+    lane.count++;
+    count++;
+    enqueued++;
+    if (count > highWater)
+    {
+      highWater = count;
+    }
+    return true;
+  }
+
+  /**
+   * @brief hand queued packets to the radio while the in-flight window has room
+   *
+   * The packet may still be changed by send, e.g. to stamp a sequence number
+   * in the order packets actually go out.
+   *
+   * @param send callable taking a TxPacket & and returning a TxSendResult
+   * @param classes classes that may send now, bit i for class i, the others keep their packets
+   * @return number of packets accepted by the radio
+   */
+  template <typename Send>
+  size_t pump(Send send, uint32_t classes = TX_ALL_CLASSES)
+  {
+    size_t sent = 0;
+    while (waiting(classes) > 0 && inFlight() < window)
+    {
+      Lane &lane = lanes[next(classes)];
+      TxPacket &packet = lane.packets[lane.head];
+      TxSendResult result = send(packet);
+      if (result == TX_RETRY || result == TX_HOLD)
+      {
+        retried += result == TX_RETRY;
+        break;
+      }
+      if (result == TX_SENT)
+      {
+        submitted++;
+        sent++;
+      }
+      else
+      {
+        failed++;
+      }
+      lane.deficit -= packet.length;
+      lane.head = (lane.head + 1) % Depth;
+      lane.count--;
+      count--;
+    }
+    return sent;
+  }
+
+  /**
+   * @brief release one in-flight slot, safe to call from the send callback
+   *
+   * @return number of the send completed, sends complete in the order they were submitted
+   */
+  uint32_t onSent()
+  {
+    return completed.fetch_add(1, std::memory_order_release);
+  }
+
+  /**
+   * @brief number the next packet accepted by the radio will have
+   */
+  uint32_t nextSend() const { return submitted; }
+
+  uint32_t inFlight() const
+  {
+    return submitted - completed.load(std::memory_order_acquire);
+  }
+
+  size_t size() const { return count; }
+
+  /**
+   * @brief packets queued in the classes of a mask, bit i for class i
+   */
+  size_t waiting(uint32_t classes) const
+  {
+    if (classes == TX_ALL_CLASSES)
+    {
+      return count;
+    }
+    size_t total = 0;
+    for (size_t i = 0; i < Classes; i++)
+    {
+      total += (classes >> i & 1) ? lanes[i].count : 0;
+    }
+    return total;
+  }
+
+  size_t size(uint8_t priority) const { return lanes[priority < Classes ? priority : Classes - 1].count; }
+  size_t space(uint8_t priority) const { return Depth - size(priority); }
+
+  // packets accepted by enqueue()
+  uint32_t enqueued;
+  // packets discarded by the drop policy
+  uint32_t dropped;
+  // sends postponed because the radio was out of buffers
+  uint32_t retried;
+  // packets rejected by the radio or too long to queue
+  uint32_t failed;
+  // largest number of packets ever queued at once, all classes together
+  size_t highWater;
+
+private:
+  /**
+   * @brief One class: a ring of packets and its deficit round robin credit in bytes
+   */
+  struct Lane
+  {
+    TxPacket packets[Depth];
+    size_t head;
+    size_t count;
+    int32_t deficit;
+    int32_t quantum;
+  };
+
+  /**
+   * @brief whether class i has a packet and may send it
+   */
+  bool ready(size_t i, uint32_t classes) const
+  {
+    return lanes[i].count > 0 && (classes >> i & 1);
+  }
+
+  /**
+   * @brief class of the next packet to send, some class of the mask must have one
+   */
+  size_t next(uint32_t classes)
+  {
+    if (schedule == TX_STRICT)
+    {
+      size_t i = 0;
+      while (!ready(i, classes))
+      {
+        i++;
+      }
+      return i;
+    }
+    // a class keeps the turn while its credit covers its next packet, every
+    // class with packets gets a new quantum once per round
+    for (;;)
+    {
+      Lane &lane = lanes[current];
+      if (!ready(current, classes))
+      {
+        // an idle or held class does not save up credit
+        lane.deficit = 0;
+      }
+      else if (lane.deficit >= lane.packets[lane.head].length)
+      {
+        return current;
+      }
+      current = (current + 1) % Classes;
+      if (ready(current, classes))
+      {
+        lanes[current].deficit += lanes[current].quantum;
+      }
+    }
+  }
+
+  Lane lanes[Classes];
+  TxDropPolicy policy;
+  uint8_t window;
+  TxSchedule schedule;
+  size_t current;
+  size_t count;
+  uint32_t submitted;
+  std::atomic<uint32_t> completed;
+};
+
+#endif
@@ -0,0 +1,404 @@
+#if defined(__linux__) && !defined(ARDUINO)
+
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include "link_host.h"
+
+// how long the node waits for the repeated proposal before it falls back (HOST_BAUD_CONFIRM_MS), plus margin
+#define LINK_HOST_FALLBACK_MS 600
+#define LINK_HOST_REPLY_MS 200
+
+/**
+ * @brief termios constant of a baud rate, B0 if there is none
+ */
+static speed_t speedFor(uint32_t baud)
+{
+  static const struct
+  {
+    uint32_t baud;
+    speed_t speed;
+  } SPEEDS[] = {
+      {9600, B9600},       {19200, B19200},     {38400, B38400},     {57600, B57600},
+      {115200, B115200},   {230400, B230400},   {460800, B460800},   {500000, B500000},
+      {576000, B576000},   {921600, B921600},   {1000000, B1000000}, {1152000, B1152000},
+      {1500000, B1500000}, {2000000, B2000000}, {2500000, B2500000}, {3000000, B3000000},
+      {3500000, B3500000}, {4000000, B4000000},
+  };
+  for (size_t i = 0; i < sizeof(SPEEDS) / sizeof(SPEEDS[0]); i++)
+  {
+    if (SPEEDS[i].baud == baud)
+    {
+      return SPEEDS[i].speed;
+    }
+  }
+  return B0;
+}
+
+static uint64_t nowMs()
+{
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+static void putU32(uint8_t *out, uint32_t value)
+{
+  for (int i = 0; i < 4; i++)
+  {
+    out[i] = value >> (8 * i);
+  }
+}
+
+static uint32_t getU32(const uint8_t *in)
+{
+  return in[0] | in[1] << 8 | (uint32_t)in[2] << 16 | (uint32_t)in[3] << 24;
+}
+
+LinkHost::LinkHost() : skippedFrames(0), fd(-1), currentBaud(0) {}
+
+LinkHost::~LinkHost()
+{
+  close();
+}
+
+bool LinkHost::open(const char *path, uint32_t baud)
+{
+  close();
+  fd = ::open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+  if (fd < 0)
+  {
+    return false;
+  }
+  termios settings;
+  if (tcgetattr(fd, &settings) < 0)
+  {
+    close();
+    return false;
+  }
+  cfmakeraw(&settings);
+  settings.c_cflag |= CLOCAL | CREAD;
+  tcsetattr(fd, TCSANOW, &settings);
+  if (!setBaud(baud))
+  {
+    close();
+    return false;
+  }
+  tcflush(fd, TCIOFLUSH);
+  return true;
+}
+
+void LinkHost::close()
+{
+  if (fd >= 0)
+  {
+    ::close(fd);
+    fd = -1;
+  }
+}
+
+bool LinkHost::setBaud(uint32_t baud)
+{
+  speed_t speed = speedFor(baud);
+  termios settings;
+  if (speed == B0 || tcgetattr(fd, &settings) < 0)
+  {
+    return false;
+  }
+  // let the last frame leave at the old rate
+  tcdrain(fd);
+  cfsetispeed(&settings, speed);
+  cfsetospeed(&settings, speed);
+  if (tcsetattr(fd, TCSANOW, &settings) < 0)
+  {
+    return false;
+  }
+  currentBaud = baud;
+  return true;
+}
+
+bool LinkHost::send(uint8_t type, const uint8_t *payload, uint16_t length, const uint8_t *macAddr, uint8_t priority,
+                    uint8_t flags)
+{
+  uint8_t frame[LINK_MAX_FRAME];
+  size_t total = linkEncode(frame, type, macAddr, payload, length, priority, flags);
+  size_t written = 0;
+  while (written < total)
+  {
+    ssize_t count = ::write(fd, &frame[written], total - written);
+    if (count < 0)
+    {
+      pollfd out = {fd, POLLOUT, 0};
+      if (poll(&out, 1, 100) <= 0)
+      {
+        return false;
+      }
+      continue;
+    }
+    written += count;
+  }
+  return total > 0;
+}
+
+bool LinkHost::fill(uint32_t timeoutMs)
+{
+  pollfd in = {fd, POLLIN, 0};
+  if (poll(&in, 1, timeoutMs) <= 0)
+  {
+    return false;
+  }
+  uint8_t chunk[512];
+  size_t wanted = parser.wanted();
+  ssize_t count = ::read(fd, chunk, wanted < sizeof(chunk) ? wanted : sizeof(chunk));
+  if (count <= 0)
+  {
+    return false;
+  }
+  parser.feed(chunk, count);
+  return true;
+}
+
+const LinkFrame *LinkHost::receive(uint8_t type, uint32_t timeoutMs)
+{
+  uint64_t deadline = nowMs() + timeoutMs;
+  for (;;)
+  {
+    const LinkFrame *frame;
+    while ((frame = parser.front()) != nullptr)
+    {
+      current = *frame;
+      parser.pop();
+      if (type == 0 || current.type == type)
+      {
+        return &current;
+      }
+      skippedFrames++;
+    }
+    uint64_t now = nowMs();
+    if (now >= deadline)
+    {
+      return nullptr;
+    }
+    fill(deadline - now);
+  }
+}
+
+uint32_t LinkHost::negotiateBaud(const uint32_t *rates, size_t count, uint32_t fallback)
+{
+  for (size_t i = 0; i < count; i++)
+  {
+    uint32_t rate = rates[i];
+    if (speedFor(rate) == B0)
+    {
+      continue;
+    }
+    uint8_t proposal[4];
+    putU32(proposal, rate);
+    const LinkFrame *reply;
+    if (!send(LINK_TYPE_BAUD, proposal, sizeof(proposal)) ||
+        (reply = receive(LINK_TYPE_BAUD, LINK_HOST_REPLY_MS)) == nullptr || reply->length != 4 ||
+        getU32(reply->payload) != rate)
+    {
+      // refused or lost, the node stays where it was
+      continue;
+    }
+    if (rate == currentBaud)
+    {
+      return rate;
+    }
+
+    // the node switches right after its acknowledgement
+    setBaud(rate);
+    usleep(10000);
+    tcflush(fd, TCIFLUSH);
+    if (send(LINK_TYPE_BAUD, proposal, sizeof(proposal)) &&
+        (reply = receive(LINK_TYPE_BAUD, LINK_HOST_REPLY_MS)) != nullptr && reply->length == 4 &&
+        getU32(reply->payload) == rate)
+    {
+      return rate;
+    }
+
+    // wait for the node to give up on the rate as well
+    setBaud(fallback);
+    usleep(LINK_HOST_FALLBACK_MS * 1000);
+    tcflush(fd, TCIFLUSH);
+  }
+  return currentBaud;
+}
+
+size_t LinkHost::neighbors(LinkNeighbor *out, size_t max)
+{
+  size_t count = 0;
+  if (!send(LINK_TYPE_NEIGHBORS, nullptr, 0))
+  {
+    return 0;
+  }
+  const LinkFrame *reply;
+  while ((reply = receive(LINK_TYPE_NEIGHBORS, LINK_HOST_REPLY_MS)) != nullptr && reply->length >= 1)
+  {
+    for (size_t offset = 1; offset + LINK_NEIGHBOR_LEN <= reply->length; offset += LINK_NEIGHBOR_LEN, count++)
+    {
+      if (count < max)
+      {
+        linkDecodeNeighbor(&reply->payload[offset], &out[count]);
+      }
+    }
+    if (!(reply->payload[0] & LINK_NEIGHBORS_MORE))
+    {
+      break;
+    }
+  }
+  return count;
+}
+
+size_t LinkHost::latency(LatencyHistogram *out, bool reset)
+{
+  uint8_t request = reset ? LINK_LATENCY_RESET : 0;
+  if (!send(LINK_TYPE_LATENCY, &request, 1))
+  {
+    return 0;
+  }
+  size_t received = 0;
+  const LinkFrame *reply;
+  while ((reply = receive(LINK_TYPE_LATENCY, LINK_HOST_REPLY_MS)) != nullptr)
+  {
+    uint8_t stage;
+    uint8_t stages;
+    LatencyHistogram histogram;
+    if (!latencyDecode(reply->payload, reply->length, &stage, &stages, &histogram) || stages == 0)
+    {
+      return 0;
+    }
+    if (stage < LATENCY_STAGES)
+    {
+      out[stage] = histogram;
+      received++;
+    }
+    if (stage + 1 >= stages)
+    {
+      break;
+    }
+  }
+  return received;
+}
+
+size_t LinkHost::metrics(uint32_t *out, size_t max)
+{
+  if (!send(LINK_TYPE_METRICS, nullptr, 0))
+  {
+    return 0;
+  }
+  return receiveMetrics(out, max, LINK_HOST_REPLY_MS);
+}
+
+size_t LinkHost::radio(uint8_t *hints, size_t count)
+{
+  if (!send(LINK_TYPE_RADIO, hints, count * LINK_RADIO_HINT_LEN))
+  {
+    return 0;
+  }
+  const LinkFrame *reply = receive(LINK_TYPE_RADIO, LINK_HOST_REPLY_MS);
+  if (reply == nullptr)
+  {
+    return 0;
+  }
+  size_t classes = reply->length / LINK_RADIO_HINT_LEN;
+  memcpy(hints, reply->payload, (classes < LINK_PRIORITIES ? classes : LINK_PRIORITIES) * LINK_RADIO_HINT_LEN);
+  return classes;
+}
+
+bool LinkHost::setPeerKey(const uint8_t *macAddr, const uint8_t *lmk)
+{
+  if (!send(LINK_TYPE_PEER, lmk, lmk != nullptr ? LINK_PEER_KEY_LEN : 0, macAddr))
+  {
+    return false;
+  }
+  const LinkFrame *reply = receive(LINK_TYPE_PEER, LINK_HOST_REPLY_MS);
+  return reply != nullptr && reply->length == 1 && reply->payload[0] == 1;
+}
+
+bool LinkHost::pushMetrics(uint32_t periodMs)
+{
+  uint8_t request[4];
+  for (int i = 0; i < 4; i++)
+  {
+    request[i] = periodMs >> (8 * i);
+  }
+  return send(LINK_TYPE_METRICS, request, sizeof(request));
+}
+
+size_t LinkHost::receiveMetrics(uint32_t *out, size_t max, uint32_t timeoutMs)
+{
+  const LinkFrame *reply = receive(LINK_TYPE_METRICS, timeoutMs);
+  if (reply == nullptr || reply->length < 1)
+  {
+    return 0;
+  }
+  size_t count = reply->payload[0];
+  for (size_t i = 0; i < count && i < max && 1 + 4 * i + 4 <= reply->length; i++)
+  {
+    const uint8_t *value = &reply->payload[1 + 4 * i];
+    out[i] = value[0] | value[1] << 8 | (uint32_t)value[2] << 16 | (uint32_t)value[3] << 24;
+  }
+  return count;
+}
+
+LinkHost::EchoResult LinkHost::measureEcho(uint16_t payloadLength, uint32_t durationMs, uint32_t window)
+{
+  EchoResult result = {};
+  uint8_t payload[LINK_MAX_PAYLOAD];
+  if (payloadLength < 4)
+  {
+    payloadLength = 4;
+  }
+  if (payloadLength > LINK_MAX_PAYLOAD)
+  {
+    payloadLength = LINK_MAX_PAYLOAD;
+  }
+  for (size_t i = 0; i < payloadLength; i++)
+  {
+    payload[i] = i;
+  }
+
+  uint32_t inFlight = 0;
+  uint64_t start = nowMs();
+  uint64_t last = start;
+  while (nowMs() - start < durationMs || inFlight > 0)
+  {
+    while (inFlight < window && nowMs() - start < durationMs)
+    {
+      putU32(payload, result.sent);
+      if (!send(LINK_TYPE_ECHO, payload, payloadLength))
+      {
+        break;
+      }
+      result.sent++;
+      inFlight++;
+    }
+    if (receive(LINK_TYPE_ECHO, LINK_HOST_REPLY_MS) != nullptr)
+    {
+      result.received++;
+      inFlight--;
+      last = nowMs();
+    }
+    else
+    {
+      // nothing for a while, whatever is in flight is gone
+      result.lost += inFlight;
+      inFlight = 0;
+    }
+  }
+
+  double seconds = (last - start) / 1000.0;
+  if (seconds > 0)
+  {
+    result.framesPerSecond = result.received / seconds;
+    result.bytesPerSecond = result.framesPerSecond * payloadLength;
+  }
+  return result;
+}
+
+#endif
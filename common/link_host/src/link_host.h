@@ -0,0 +1,162 @@
+#ifndef __LINK_HOST_H__
+#define __LINK_HOST_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <link_protocol.h>
+#include <latency_histogram.h>
+
+/**
+ * @brief Host side of the serial link to a relay node (Linux, termios)
+ *
+ * Opens the node's serial port, sends and receives link frames, negotiates
+ * the baud rate with LINK_TYPE_BAUD and measures the link with LINK_TYPE_ECHO.
+ */
+class LinkHost
+{
+public:
+  LinkHost();
+  ~LinkHost();
+
+  /**
+   * @brief opens a serial port in raw mode
+   *
+   * @param path device, e.g. /dev/ttyUSB0 or a simulated node's pty
+   * @param baud rate the node booted with (HOST_BAUD)
+   */
+  bool open(const char *path, uint32_t baud);
+  void close();
+
+  /**
+   * @brief changes the local port rate only, see negotiateBaud()
+   *
+   * @return false if termios has no constant for this rate
+   */
+  bool setBaud(uint32_t baud);
+  uint32_t baud() const { return currentBaud; }
+
+  /**
+   * @brief writes one frame
+   *
+   * @param type one of LinkType
+   * @param macAddr 6 byte mac address, nullptr to leave it out
+   * @param priority one of LinkPriority, for LINK_TYPE_DATA
+   * @param flags LINK_FLAG_RADIO if a LINK_TYPE_DATA payload starts with a radio hint
+   */
+  bool send(uint8_t type, const uint8_t *payload, uint16_t length, const uint8_t *macAddr = nullptr,
+            uint8_t priority = LINK_PRIORITY_URGENT, uint8_t flags = 0);
+
+  /**
+   * @brief waits for the next frame of a type, frames of other types are dropped
+   *
+   * @param type one of LinkType, 0 for any
+   * @param timeoutMs how long to wait
+   * @return the frame, valid until the next call, nullptr on timeout
+   */
+  const LinkFrame *receive(uint8_t type, uint32_t timeoutMs);
+
+  /**
+   * @brief agrees with the node on the fastest of the given rates
+   *
+   * Tries each rate in the given order: proposes it, switches when the node
+   * acknowledges and repeats the proposal at the new rate. A rate the node
+   * refuses or does not confirm is skipped, after waiting for the node to
+   * fall back to the boot rate.
+   *
+   * @param rates candidate rates, fastest first
+   * @param count number of rates
+   * @param fallback rate the node boots and falls back with (HOST_BAUD)
+   * @return the rate in use afterwards, fallback if none worked
+   */
+  uint32_t negotiateBaud(const uint32_t *rates, size_t count, uint32_t fallback);
+
+  /**
+   * @brief Echo round trips through the node at the current rate
+   */
+  struct EchoResult
+  {
+    uint32_t sent;
+    uint32_t received;
+    uint32_t lost;         /**< echoes not back within the timeout */
+    double framesPerSecond; /**< echoes received per second */
+    double bytesPerSecond;  /**< payload bytes per second, each way */
+  };
+
+  /**
+   * @brief keeps a few echo frames in flight for a while and counts the replies
+   *
+   * @param payloadLength bytes per frame, at least 4 for the sequence number
+   * @param durationMs how long to measure
+   * @param window frames in flight, at most the node's HOST_QUEUE_SIZE
+   */
+  EchoResult measureEcho(uint16_t payloadLength, uint32_t durationMs, uint32_t window);
+
+  /**
+   * @brief asks the node which neighbors it heard recently
+   *
+   * @param out filled with at most max neighbors
+   * @return number of neighbors reported, more than max if some did not fit
+   */
+  size_t neighbors(LinkNeighbor *out, size_t max);
+
+  /**
+   * @brief fetches the node's latency histograms
+   *
+   * @param out LATENCY_STAGES histograms, indexed by LatencyStage
+   * @param reset have the node clear them once sent
+   * @return number of stages received, 0 if the node was built without LATENCY_STATS or did not answer
+   */
+  size_t latency(LatencyHistogram *out, bool reset);
+
+  /**
+   * @brief fetches the node's counters
+   *
+   * @param out indexed by LinkMetric, filled with at most max counters
+   * @return number of counters the node sent, 0 if it did not answer
+   */
+  size_t metrics(uint32_t *out, size_t max);
+
+  /**
+   * @brief sets the radio rate and transmit power of the first classes
+   *
+   * @param hints [LinkRate][power in 0.25 dBm] per class from the most urgent, filled with
+   * those of all LINK_PRIORITIES classes on return, so LINK_PRIORITIES * LINK_RADIO_HINT_LEN bytes
+   * @param count classes to set, 0 to only read them
+   * @return number of classes the node reported, 0 if it did not answer
+   */
+  size_t radio(uint8_t *hints, size_t count);
+
+  /**
+   * @brief sets the key unicast frames to and from a node are encrypted with,
+   * both nodes need the other's
+   *
+   * @param lmk LINK_PEER_KEY_LEN bytes, nullptr to remove the key
+   * @return false if the node refused it or did not answer
+   */
+  bool setPeerKey(const uint8_t *macAddr, const uint8_t *lmk);
+
+  /**
+   * @brief has the node send its counters every periodMs, 0 to stop
+   *
+   * Read the blocks with receiveMetrics(), the first one comes right away.
+   */
+  bool pushMetrics(uint32_t periodMs);
+
+  /**
+   * @brief waits for the next metrics block, as metrics()
+   */
+  size_t receiveMetrics(uint32_t *out, size_t max, uint32_t timeoutMs);
+
+  // frames dropped by receive() because they were not the wanted type
+  uint32_t skippedFrames;
+
+private:
+  bool fill(uint32_t timeoutMs);
+
+  int fd;
+  uint32_t currentBaud;
+  LinkParser<8> parser;
+  LinkFrame current;
+};
+
+#endif
@@ -0,0 +1,102 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <link_host.h>
+
+#define MAX_RATES 16
+
+/**
+ * @brief prints the command line options
+ */
+static void usage(const char *program)
+{
+  fprintf(stderr,
+          "usage: %s PORT [--boot BAUD] [--rates B1,B2,...] [--size N] [--ms N] [--window N]\n"
+          "  PORT          serial port of the node, e.g. /dev/ttyUSB0 or /tmp/espnow/node-1\n"
+          "  --boot BAUD   rate the node boots with, HOST_BAUD (default 115200)\n"
+          "  --rates LIST  rates to measure (default 115200,230400,460800,921600,1000000,2000000)\n"
+          "  --size N      echo payload bytes (default 250)\n"
+          "  --ms N        measuring time per rate (default 2000)\n"
+          "  --window N    echo frames in flight, at most HOST_QUEUE_SIZE (default 4)\n"
+          "Negotiates each rate in turn, measures echo round trips and prints one csv line per rate.\n",
+          program);
+}
+
+int main(int argc, char **argv)
+{
+  const char *port = nullptr;
+  uint32_t boot = 115200;
+  uint32_t rates[MAX_RATES] = {115200, 230400, 460800, 921600, 1000000, 2000000};
+  size_t rateCount = 6;
+  uint16_t size = LINK_MAX_PAYLOAD;
+  uint32_t durationMs = 2000;
+  uint32_t window = 4;
+
+  for (int i = 1; i < argc; i++)
+  {
+    if (i + 1 < argc && strcmp(argv[i], "--boot") == 0)
+    {
+      boot = strtoul(argv[++i], nullptr, 10);
+    }
+    else if (i + 1 < argc && strcmp(argv[i], "--rates") == 0)
+    {
+      char *next = argv[++i];
+      for (rateCount = 0; rateCount < MAX_RATES && *next != '\0'; rateCount++)
+      {
+        rates[rateCount] = strtoul(next, &next, 10);
+        next += *next == ',';
+      }
+    }
+    else if (i + 1 < argc && strcmp(argv[i], "--size") == 0)
+    {
+      size = atoi(argv[++i]);
+    }
+    else if (i + 1 < argc && strcmp(argv[i], "--ms") == 0)
+    {
+      durationMs = strtoul(argv[++i], nullptr, 10);
+    }
+    else if (i + 1 < argc && strcmp(argv[i], "--window") == 0)
+    {
+      window = strtoul(argv[++i], nullptr, 10);
+    }
+    else if (port == nullptr && argv[i][0] != '-')
+    {
+      port = argv[i];
+    }
+    else
+    {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (port == nullptr)
+  {
+    usage(argv[0]);
+    return 2;
+  }
+
+  LinkHost link;
+  if (!link.open(port, boot))
+  {
+    perror(port);
+    return 1;
+  }
+
+  printf("baud,payload,sent,received,lost,frames_per_s,payload_bytes_per_s\n");
+  for (size_t i = 0; i < rateCount; i++)
+  {
+    if (link.negotiateBaud(&rates[i], 1, boot) != rates[i])
+    {
+      fprintf(stderr, "%u baud: not accepted, skipped\n", (unsigned)rates[i]);
+      continue;
+    }
+    LinkHost::EchoResult result = link.measureEcho(size, durationMs, window);
+    printf("%u,%u,%u,%u,%u,%.1f,%.0f\n", (unsigned)rates[i], (unsigned)size, (unsigned)result.sent,
+           (unsigned)result.received, (unsigned)result.lost, result.framesPerSecond, result.bytesPerSecond);
+    fflush(stdout);
+  }
+
+  // leave the node where it boots
+  link.negotiateBaud(&boot, 1, boot);
+  return 0;
+}
@@ -0,0 +1,264 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <link_host.h>
+
+#define MAX_LIST 32
+#define MAX_PAYLOAD 250
+#define DRAIN_MS 500
+
+/**
+ * @brief prints the command line options
+ */
+static void usage(const char *program)
+{
+  fprintf(stderr,
+          "usage: %s SENDER RECEIVER [--boot BAUD] [--baud BAUD] [--sizes LIST] [--rates LIST] [--ms N]\n"
+          "          [--priority P]\n"
+          "  SENDER        serial port of the node that broadcasts, e.g. /tmp/espnow/node-1\n"
+          "  RECEIVER      serial port of a node in range, e.g. /tmp/espnow/node-2\n"
+          "  --boot BAUD   rate the nodes boot with, HOST_BAUD (default 115200)\n"
+          "  --baud BAUD   negotiate this rate with both nodes first (default: stay at --boot)\n"
+          "  --sizes LIST  payload bytes, 1 to 250 (default 1,16,64,128,200,250)\n"
+          "  --rates LIST  offered messages per second (default 100,500,1000,2000)\n"
+          "  --ms N        sending time per point (default 2000)\n"
+          "  --priority P  priority class of the messages, 0 to 3 (default 0)\n"
+          "Sends data frames through the sender and times them out of the receiver, one csv line\n"
+          "per size and rate. Other nodes in range should stay quiet.\n",
+          program);
+}
+
+static uint64_t nowUs()
+{
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static void sleepUntilUs(uint64_t deadlineUs)
+{
+  timespec deadline = {(time_t)(deadlineUs / 1000000), (long)(deadlineUs % 1000000) * 1000};
+  clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr);
+}
+
+static size_t parseList(char *next, uint32_t *out)
+{
+  size_t count;
+  for (count = 0; count < MAX_LIST && *next != '\0'; count++)
+  {
+    out[count] = strtoul(next, &next, 10);
+    next += *next == ',';
+  }
+  return count;
+}
+
+/**
+ * @brief One size and rate: send times by message number, filled by the
+ * sending thread, and what the receiving thread made of them
+ *
+ * Each message carries its number in its first bytes, as many as fit up to
+ * 4. The relay keeps messages in order, so a received number is matched to
+ * the next message sent with the same low bytes and the ones skipped over
+ * count as lost.
+ */
+struct Point
+{
+  std::vector<uint64_t> sentUs;
+  std::atomic<uint32_t> sent;
+  std::atomic<bool> done;
+  std::vector<uint32_t> latencyUs;
+  uint32_t expected;
+  uint64_t payloadBytes;
+};
+
+static void receive(LinkHost *link, Point *point, uint16_t size)
+{
+  size_t width = size < 4 ? size : 4;
+  uint32_t mask = width == 4 ? 0xFFFFFFFF : (1u << (8 * width)) - 1;
+  while (!point->done.load())
+  {
+    const LinkFrame *frame = link->receive(LINK_TYPE_DATA, 50);
+    if (frame == nullptr || frame->length != size)
+    {
+      continue;
+    }
+    uint64_t receivedUs = nowUs();
+    uint32_t low = 0;
+    for (size_t i = 0; i < width; i++)
+    {
+      low |= (uint32_t)frame->payload[i] << (8 * i);
+    }
+    uint32_t number = point->expected + ((low - point->expected) & mask);
+    if (number >= point->sent.load(std::memory_order_acquire))
+    {
+      // not sent in this point: a straggler of the last one, or another node
+      continue;
+    }
+    point->latencyUs.push_back(receivedUs - point->sentUs[number]);
+    point->payloadBytes += size;
+    point->expected = number + 1;
+  }
+}
+
+/**
+ * @brief sends for durationMs at the offered rate and prints the csv line
+ */
+static void run(LinkHost &sender, LinkHost &receiver, uint16_t size, uint32_t rate, uint32_t durationMs,
+                uint8_t priority)
+{
+  Point point;
+  point.sentUs.resize((uint64_t)rate * durationMs / 1000 + 1);
+  point.sent = 0;
+  point.done = false;
+  point.latencyUs.reserve(point.sentUs.size());
+  point.expected = 0;
+  point.payloadBytes = 0;
+
+  uint8_t payload[MAX_PAYLOAD];
+  for (size_t i = 0; i < size; i++)
+  {
+    payload[i] = i;
+  }
+
+  std::thread receiving(receive, &receiver, &point, size);
+  uint64_t startUs = nowUs();
+  uint64_t intervalUs = 1000000 / rate;
+  uint32_t count = 0;
+  for (; count < point.sentUs.size(); count++)
+  {
+    uint64_t dueUs = startUs + count * intervalUs;
+    if (dueUs >= startUs + durationMs * 1000ull)
+    {
+      break;
+    }
+    // behind schedule when the serial port is the bottleneck: send back to back
+    sleepUntilUs(dueUs);
+    for (size_t i = 0; i < size && i < 4; i++)
+    {
+      payload[i] = count >> (8 * i);
+    }
+    point.sentUs[count] = nowUs();
+    point.sent.store(count + 1, std::memory_order_release);
+    if (!sender.send(LINK_TYPE_DATA, payload, size, nullptr, priority))
+    {
+      break;
+    }
+  }
+  double sendingS = (nowUs() - startUs) / 1e6;
+  usleep(DRAIN_MS * 1000);
+  point.done = true;
+  receiving.join();
+
+  std::vector<uint32_t> &latency = point.latencyUs;
+  std::sort(latency.begin(), latency.end());
+  size_t received = latency.size();
+  uint32_t sent = point.sent.load();
+  auto at = [&](double share) -> unsigned
+  { return received == 0 ? 0 : latency[std::min(received - 1, (size_t)(share * received))]; };
+  printf("%u,%u,%.0f,%u,%u,%u,%.2f,%.0f,%u,%u,%u,%u\n", (unsigned)size, (unsigned)rate, sent / sendingS,
+         (unsigned)sent, (unsigned)received, (unsigned)(sent - received),
+         sent ? 100.0 * (sent - received) / sent : 0.0, point.payloadBytes / sendingS, at(0.5), at(0.99),
+         at(0.999), received ? (unsigned)latency.back() : 0);
+  fflush(stdout);
+}
+
+int main(int argc, char **argv)
+{
+  const char *ports[2] = {nullptr, nullptr};
+  uint32_t boot = 115200;
+  uint32_t baud = 0;
+  uint32_t sizes[MAX_LIST] = {1, 16, 64, 128, 200, 250};
+  size_t sizeCount = 6;
+  uint32_t rates[MAX_LIST] = {100, 500, 1000, 2000};
+  size_t rateCount = 4;
+  uint32_t durationMs = 2000;
+  uint8_t priority = LINK_PRIORITY_URGENT;
+
+  for (int i = 1; i < argc; i++)
+  {
+    if (i + 1 < argc && strcmp(argv[i], "--boot") == 0)
+    {
+      boot = strtoul(argv[++i], nullptr, 10);
+    }
+    else if (i + 1 < argc && strcmp(argv[i], "--baud") == 0)
+    {
+      baud = strtoul(argv[++i], nullptr, 10);
+    }
+    else if (i + 1 < argc && strcmp(argv[i], "--sizes") == 0)
+    {
+      sizeCount = parseList(argv[++i], sizes);
+    }
+    else if (i + 1 < argc && strcmp(argv[i], "--rates") == 0)
+    {
+      rateCount = parseList(argv[++i], rates);
+    }
+    else if (i + 1 < argc && strcmp(argv[i], "--ms") == 0)
+    {
+      durationMs = strtoul(argv[++i], nullptr, 10);
+    }
+    else if (i + 1 < argc && strcmp(argv[i], "--priority") == 0)
+    {
+      priority = atoi(argv[++i]);
+    }
+    else if (ports[1] == nullptr && argv[i][0] != '-')
+    {
+      ports[ports[0] == nullptr ? 0 : 1] = argv[i];
+    }
+    else
+    {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (ports[1] == nullptr)
+  {
+    usage(argv[0]);
+    return 2;
+  }
+
+  LinkHost links[2];
+  for (int i = 0; i < 2; i++)
+  {
+    if (!links[i].open(ports[i], boot))
+    {
+      perror(ports[i]);
+      return 1;
+    }
+    if (baud != 0 && links[i].negotiateBaud(&baud, 1, boot) != baud)
+    {
+      fprintf(stderr, "%s: %u baud not accepted, staying at %u\n", ports[i], (unsigned)baud,
+              (unsigned)links[i].baud());
+    }
+  }
+
+  printf("payload,offered_per_s,sent_per_s,sent,received,lost,loss_pct,goodput_bytes_per_s,p50_us,p99_us,p999_us,"
+         "max_us\n");
+  for (size_t s = 0; s < sizeCount; s++)
+  {
+    if (sizes[s] < 1 || sizes[s] > MAX_PAYLOAD)
+    {
+      fprintf(stderr, "%u bytes: not 1 to %u, skipped\n", (unsigned)sizes[s], MAX_PAYLOAD);
+      continue;
+    }
+    for (size_t r = 0; r < rateCount; r++)
+    {
+      if (rates[r] > 0)
+      {
+        run(links[0], links[1], sizes[s], rates[r], durationMs, priority);
+      }
+    }
+  }
+
+  // leave the nodes where they boot
+  for (int i = 0; baud != 0 && i < 2; i++)
+  {
+    links[i].negotiateBaud(&boot, 1, boot);
+  }
+  return 0;
+}
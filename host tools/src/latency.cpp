@@ -0,0 +1,89 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <link_host.h>
+
+/**
+ * @brief prints the command line options
+ */
+static void usage(const char *program)
+{
+  fprintf(stderr,
+          "usage: %s PORT [--baud BAUD] [--every MS] [--reset]\n"
+          "  PORT         serial port of the node, e.g. /dev/ttyUSB0 or /tmp/espnow/node-1\n"
+          "  --baud BAUD  current rate of the link (default 115200)\n"
+          "  --every MS   repeat every MS milliseconds instead of once\n"
+          "  --reset      clear the node's histograms after each dump\n"
+          "Prints where messages spend their time in a node built with -DLATENCY_STATS=true.\n",
+          program);
+}
+
+int main(int argc, char **argv)
+{
+  static const char *STAGE_NAMES[LATENCY_STAGES] = {"serial->queue", "queue->radio", "radio->sent", "recv->serial"};
+  const char *port = nullptr;
+  uint32_t baud = 115200;
+  uint32_t everyMs = 0;
+  bool reset = false;
+
+  for (int i = 1; i < argc; i++)
+  {
+    if (i + 1 < argc && strcmp(argv[i], "--baud") == 0)
+    {
+      baud = strtoul(argv[++i], nullptr, 10);
+    }
+    else if (i + 1 < argc && strcmp(argv[i], "--every") == 0)
+    {
+      everyMs = strtoul(argv[++i], nullptr, 10);
+    }
+    else if (strcmp(argv[i], "--reset") == 0)
+    {
+      reset = true;
+    }
+    else if (port == nullptr && argv[i][0] != '-')
+    {
+      port = argv[i];
+    }
+    else
+    {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (port == nullptr)
+  {
+    usage(argv[0]);
+    return 2;
+  }
+
+  LinkHost link;
+  if (!link.open(port, baud))
+  {
+    perror(port);
+    return 1;
+  }
+
+  static LatencyHistogram histograms[LATENCY_STAGES];
+  do
+  {
+    if (link.latency(histograms, reset) != LATENCY_STAGES)
+    {
+      fprintf(stderr, "no histograms, is the node built with -DLATENCY_STATS=true?\n");
+      return 1;
+    }
+    printf("%-14s %9s %9s %8s %8s %8s %8s %8s\n", "stage us", "count", "mean", "p50", "p90", "p99", "p99.9",
+           "max");
+    for (size_t stage = 0; stage < LATENCY_STAGES; stage++)
+    {
+      const LatencyHistogram &h = histograms[stage];
+      printf("%-14s %9u %9.1f %8u %8u %8u %8u %8u\n", STAGE_NAMES[stage], (unsigned)h.count,
+             h.count ? (double)h.sumUs / h.count : 0.0, (unsigned)h.percentile(0.5), (unsigned)h.percentile(0.9),
+             (unsigned)h.percentile(0.99), (unsigned)h.percentile(0.999), (unsigned)h.maxUs);
+    }
+    printf("\n");
+    fflush(stdout);
+    usleep(everyMs * 1000);
+  } while (everyMs > 0);
+  return 0;
+}
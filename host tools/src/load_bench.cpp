@@ -0,0 +1,296 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <thread>
+#include <vector>
+#include <air_frame.h>
+#include <hal.h>
+#include <link_host.h>
+
+#define MAX_NODES 128
+#define MAX_LIST 32
+#define MAGIC 0x4C
+// magic, sender, number and send time
+#define HEADER_LEN 14
+#define DRAIN_MS 1000
+
+// --rate names, indexed by LinkRate
+static const char *const RATE_NAMES[LINK_RATES] = {"default", "1",    "2",    "5.5",  "11",   "6",    "9",
+                                                   "12",      "18",   "24",   "36",   "48",   "54",   "mcs0",
+                                                   "mcs1",    "mcs2", "mcs3", "mcs4", "mcs5", "mcs6", "mcs7"};
+
+/**
+ * @brief prints the command line options
+ */
+static void usage(const char *program)
+{
+  fprintf(stderr,
+          "usage: %s PORT... [--rates LIST] [--size N] [--seconds N] [--priority P] [--rate R] [--power P]\n"
+          "       [--baud BAUD]\n"
+          "  PORT...         serial ports of the nodes, all in range of each other,\n"
+          "                  e.g. /tmp/espnow/node-{1..50}\n"
+          "  --rates LIST    messages per second each node sends (default 2,5,10,20,40)\n"
+          "  --size N        payload bytes, 14 to 240 (default 100)\n"
+          "  --seconds N     sending time per rate (default 10)\n"
+          "  --priority P    priority class of the messages, 0 to 3 (default 2)\n"
+          "  --rate R        PHY rate of every class in Mbit/s, 1 2 5.5 11 6 9 12 18 24 36 48 54\n"
+          "                  or mcs0 to mcs7 (default: the nodes' own)\n"
+          "  --power P       transmit power of every class in 0.25 dBm, 8 to 84 (default: the nodes' own)\n"
+          "  --baud BAUD     current rate of the links (default 115200)\n"
+          "Every node broadcasts at the same rate, at random points so they do not march in\n"
+          "step. For each rate prints the offered airtime, the messages delivered per second\n"
+          "over all receivers, the share of sent messages each other node got and their latency,\n"
+          "then the channel load and airtime share the nodes report (DCC builds).\n",
+          program);
+}
+
+static uint64_t nowUs()
+{
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static size_t parseList(char *next, uint32_t *out)
+{
+  size_t count;
+  for (count = 0; count < MAX_LIST && *next != '\0'; count++)
+  {
+    out[count] = strtoul(next, &next, 10);
+    next += *next == ',';
+  }
+  return count;
+}
+
+/**
+ * @brief what one node sent and received during a rate
+ */
+struct NodeRun
+{
+  uint32_t sent;
+  std::vector<uint32_t> latencyUs;
+  uint32_t metrics[LINK_METRICS]; /**< as sending ended, before the air goes quiet */
+};
+
+/**
+ * @brief sends through one node at ratePerS until endUs and keeps receiving for DRAIN_MS after,
+ * asks for the node's counters at endUs
+ */
+static void runNode(LinkHost *link, uint8_t index, uint32_t ratePerS, uint32_t size, uint8_t priority,
+                    uint64_t endUs, NodeRun *run)
+{
+  uint8_t payload[RADIO_MAX_PAYLOAD];
+  memset(payload, 0, sizeof(payload));
+  payload[0] = MAGIC;
+  payload[1] = index;
+  uint64_t nextUs = nowUs() + rand() % (1000000 / ratePerS);
+  uint32_t number = 0;
+  bool asked = false;
+  while (nowUs() < endUs + DRAIN_MS * 1000)
+  {
+    uint64_t now = nowUs();
+    if (!asked && now >= endUs)
+    {
+      // the reply comes in among the data frames
+      link->send(LINK_TYPE_METRICS, nullptr, 0);
+      asked = true;
+    }
+    if (now >= nextUs && now < endUs)
+    {
+      for (int b = 0; b < 4; b++)
+      {
+        payload[2 + b] = number >> (8 * b);
+      }
+      for (int b = 0; b < 8; b++)
+      {
+        payload[6 + b] = now >> (8 * b);
+      }
+      link->send(LINK_TYPE_DATA, payload, size, nullptr, priority);
+      number++;
+      // poisson arrivals, like independent vehicles
+      nextUs += (uint64_t)(-log((rand() + 1.0) / (RAND_MAX + 2.0)) * 1000000 / ratePerS);
+    }
+    const LinkFrame *frame = link->receive(0, 1);
+    if (frame != nullptr && frame->type == LINK_TYPE_METRICS && frame->length >= 1)
+    {
+      for (size_t i = 0; i < frame->payload[0] && i < LINK_METRICS && 1 + 4 * i + 4 <= frame->length; i++)
+      {
+        const uint8_t *value = &frame->payload[1 + 4 * i];
+        run->metrics[i] = value[0] | value[1] << 8 | (uint32_t)value[2] << 16 | (uint32_t)value[3] << 24;
+      }
+    }
+    if (frame == nullptr || frame->type != LINK_TYPE_DATA || frame->length < HEADER_LEN || frame->payload[0] != MAGIC)
+    {
+      continue;
+    }
+    uint64_t sentUs = 0;
+    for (int b = 0; b < 8; b++)
+    {
+      sentUs |= (uint64_t)frame->payload[6 + b] << (8 * b);
+    }
+    run->latencyUs.push_back(nowUs() - sentUs);
+  }
+  run->sent = number;
+}
+
+int main(int argc, char **argv)
+{
+  const char *ports[MAX_NODES];
+  size_t nodes = 0;
+  uint32_t rates[MAX_LIST] = {2, 5, 10, 20, 40};
+  size_t rateCount = 5;
+  uint32_t size = 100;
+  uint32_t seconds = 10;
+  uint32_t priority = 2;
+  uint32_t baud = 115200;
+  uint8_t rate = LINK_RATE_DEFAULT;
+  uint32_t power = 0;
+
+  for (int i = 1; i < argc; i++)
+  {
+    if (i + 1 < argc && strcmp(argv[i], "--rates") == 0)
+    {
+      rateCount = parseList(argv[++i], rates);
+    }
+    else if (i + 1 < argc && strcmp(argv[i], "--size") == 0)
+    {
+      size = strtoul(argv[++i], nullptr, 10);
+    }
+    else if (i + 1 < argc && strcmp(argv[i], "--seconds") == 0)
+    {
+      seconds = strtoul(argv[++i], nullptr, 10);
+    }
+    else if (i + 1 < argc && strcmp(argv[i], "--priority") == 0)
+    {
+      priority = strtoul(argv[++i], nullptr, 10);
+    }
+    else if (i + 1 < argc && strcmp(argv[i], "--rate") == 0)
+    {
+      i++;
+      rate = LINK_RATE_1M;
+      while (rate < LINK_RATES && strcmp(argv[i], RATE_NAMES[rate]) != 0)
+      {
+        rate++;
+      }
+    }
+    else if (i + 1 < argc && strcmp(argv[i], "--power") == 0)
+    {
+      power = strtoul(argv[++i], nullptr, 10);
+    }
+    else if (i + 1 < argc && strcmp(argv[i], "--baud") == 0)
+    {
+      baud = strtoul(argv[++i], nullptr, 10);
+    }
+    else if (nodes < MAX_NODES && argv[i][0] != '-')
+    {
+      ports[nodes++] = argv[i];
+    }
+    else
+    {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (nodes < 2 || size < HEADER_LEN || size > 240 || seconds == 0 || priority >= LINK_PRIORITIES ||
+      rate >= LINK_RATES || (power != 0 && (power < RADIO_MIN_TX_POWER || power > RADIO_MAX_TX_POWER)))
+  {
+    usage(argv[0]);
+    return 2;
+  }
+  for (size_t r = 0; r < rateCount; r++)
+  {
+    if (rates[r] == 0)
+    {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+
+  static LinkHost links[MAX_NODES];
+  for (size_t i = 0; i < nodes; i++)
+  {
+    if (!links[i].open(ports[i], baud))
+    {
+      perror(ports[i]);
+      return 1;
+    }
+  }
+  srand(nowUs());
+  if (rate != LINK_RATE_DEFAULT || power != 0)
+  {
+    uint8_t hints[LINK_PRIORITIES * LINK_RADIO_HINT_LEN];
+    for (size_t c = 0; c < LINK_PRIORITIES; c++)
+    {
+      hints[2 * c] = rate;
+      hints[2 * c + 1] = power;
+    }
+    for (size_t i = 0; i < nodes; i++)
+    {
+      if (links[i].radio(hints, LINK_PRIORITIES) == 0)
+      {
+        fprintf(stderr, "%s: no radio settings reply\n", ports[i]);
+        return 1;
+      }
+    }
+  }
+
+  static uint32_t before[MAX_NODES][LINK_METRICS];
+  uint32_t airtimeUs = radioAirtimeUs(AIR_HEADER_LEN + size, rate);
+  printf("%u nodes, %u byte messages, PHY rate %s, %u us on the air each, %u s per rate\n", (unsigned)nodes,
+         (unsigned)size, RATE_NAMES[rate], (unsigned)airtimeUs, (unsigned)seconds);
+  printf("%8s %9s %8s %12s %10s %9s %9s %7s %7s %9s %9s\n", "rate/s", "offered%", "sent", "delivered/s",
+         "received%", "p50 ms", "p99 ms", "busy%", "share%", "held", "dropped");
+  for (size_t r = 0; r < rateCount; r++)
+  {
+    for (size_t i = 0; i < nodes; i++)
+    {
+      memset(before[i], 0, sizeof(before[i]));
+      links[i].metrics(before[i], LINK_METRICS);
+    }
+    std::vector<NodeRun> runs(nodes);
+    std::vector<std::thread> threads;
+    uint64_t endUs = nowUs() + (uint64_t)seconds * 1000000;
+    for (size_t i = 0; i < nodes; i++)
+    {
+      runs[i].sent = 0;
+      memset(runs[i].metrics, 0, sizeof(runs[i].metrics));
+      threads.push_back(
+          std::thread(runNode, &links[i], (uint8_t)i, rates[r], size, (uint8_t)priority, endUs, &runs[i]));
+    }
+    for (std::thread &thread : threads)
+    {
+      thread.join();
+    }
+
+    uint64_t sent = 0;
+    std::vector<uint32_t> latencyUs;
+    uint64_t busy = 0;
+    uint64_t share = 0;
+    uint64_t held = 0;
+    uint64_t dropped = 0;
+    for (size_t i = 0; i < nodes; i++)
+    {
+      const uint32_t *after = runs[i].metrics;
+      sent += runs[i].sent;
+      latencyUs.insert(latencyUs.end(), runs[i].latencyUs.begin(), runs[i].latencyUs.end());
+      busy += after[LINK_METRIC_DCC_BUSY];
+      share += after[LINK_METRIC_DCC_SHARE];
+      held += after[LINK_METRIC_DCC_HELD] - before[i][LINK_METRIC_DCC_HELD];
+      dropped += after[LINK_METRIC_TX_DROPPED] - before[i][LINK_METRIC_TX_DROPPED];
+    }
+    std::sort(latencyUs.begin(), latencyUs.end());
+    size_t n = latencyUs.size();
+    // the air a second of every node's messages would take, 100% is all of it
+    double offered = 100.0 * nodes * rates[r] * airtimeUs / 1e6;
+    printf("%8u %9.1f %8llu %12.1f %10.1f %9.2f %9.2f %7.1f %7.1f %9llu %9llu\n", (unsigned)rates[r], offered,
+           (unsigned long long)sent, (double)n / seconds, sent ? 100.0 * n / (sent * (nodes - 1)) : 0.0,
+           n ? latencyUs[n / 2] / 1000.0 : 0, n ? latencyUs[std::min(n - 1, n * 99 / 100)] / 1000.0 : 0,
+           busy / 10.0 / nodes, share / 10.0 / nodes, (unsigned long long)held, (unsigned long long)dropped);
+    fflush(stdout);
+  }
+  return 0;
+}
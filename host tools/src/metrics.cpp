@@ -0,0 +1,190 @@
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <link_host.h>
+
+/**
+ * @brief prints the command line options
+ */
+static void usage(const char *program)
+{
+  fprintf(stderr,
+          "usage: %s PORT [--baud BAUD] [--every MS]\n"
+          "  PORT         serial port of the node, e.g. /dev/ttyUSB0 or /tmp/espnow/node-1\n"
+          "  --baud BAUD  current rate of the link (default 115200)\n"
+          "  --every MS   have the node push its counters every MS milliseconds and print\n"
+          "               the change per second too, until interrupted\n"
+          "Prints a node's counters.\n",
+          program);
+}
+
+static const char *METRIC_NAMES[] = {
+    "uptime_ms",
+    "tx_ok",
+    "tx_not_init",
+    "tx_arg",
+    "tx_no_mem",
+    "tx_not_found",
+    "tx_internal",
+    "tx_error",
+    "tx_unconfirmed",
+    "tx_dropped",
+    "tx_queue_high",
+    "rx_frames",
+    "rx_bytes",
+    "rx_invalid",
+    "rx_duplicates",
+    "rx_dropped",
+    "rx_ring_high",
+    "reassembled",
+    "reassembly_timeouts",
+    "reassembly_dropped",
+    "host_frames",
+    "host_crc_errors",
+    "host_skipped_bytes",
+    "host_queue_high",
+    "serial_frames_out",
+    "receive_callback_max_us",
+    "sent_callback_max_us",
+    "relay_scheduled",
+    "relay_forwarded",
+    "relay_cancelled",
+    "relay_dropped",
+    "channel",
+    "channel_switches",
+    "sync_sent",
+    "sync_adjusted",
+    "dcc_busy_permille",
+    "dcc_share_permille",
+    "dcc_held",
+    "radio_changes",
+    "radio_refused",
+    "peer_hits",
+    "peer_misses",
+    "peer_evictions",
+};
+static_assert(sizeof(METRIC_NAMES) / sizeof(METRIC_NAMES[0]) == LINK_METRICS, "a name per LinkMetric");
+
+/**
+ * @brief true for counters that only grow, false for maxima, the uptime, the channel and the DCC ratios
+ */
+static bool isCounter(size_t metric)
+{
+  switch (metric)
+  {
+  case LINK_METRIC_UPTIME_MS:
+  case LINK_METRIC_TX_QUEUE_HIGH:
+  case LINK_METRIC_RX_RING_HIGH:
+  case LINK_METRIC_HOST_QUEUE_HIGH:
+  case LINK_METRIC_RECEIVE_CALLBACK_MAX_US:
+  case LINK_METRIC_SENT_CALLBACK_MAX_US:
+  case LINK_METRIC_CHANNEL:
+  case LINK_METRIC_DCC_BUSY:
+  case LINK_METRIC_DCC_SHARE:
+    return false;
+  default:
+    return true;
+  }
+}
+
+static volatile sig_atomic_t interrupted = 0;
+
+static void onInterrupt(int)
+{
+  interrupted = 1;
+}
+
+int main(int argc, char **argv)
+{
+  const char *port = nullptr;
+  uint32_t baud = 115200;
+  uint32_t everyMs = 0;
+
+  for (int i = 1; i < argc; i++)
+  {
+    if (i + 1 < argc && strcmp(argv[i], "--baud") == 0)
+    {
+      baud = strtoul(argv[++i], nullptr, 10);
+    }
+    else if (i + 1 < argc && strcmp(argv[i], "--every") == 0)
+    {
+      everyMs = strtoul(argv[++i], nullptr, 10);
+    }
+    else if (port == nullptr && argv[i][0] != '-')
+    {
+      port = argv[i];
+    }
+    else
+    {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (port == nullptr)
+  {
+    usage(argv[0]);
+    return 2;
+  }
+
+  LinkHost link;
+  if (!link.open(port, baud))
+  {
+    perror(port);
+    return 1;
+  }
+
+  uint32_t values[LINK_METRICS];
+  if (everyMs == 0)
+  {
+    if (link.metrics(values, LINK_METRICS) == 0)
+    {
+      fprintf(stderr, "no answer from %s\n", port);
+      return 1;
+    }
+    for (size_t i = 0; i < LINK_METRICS; i++)
+    {
+      printf("%-24s %10u\n", METRIC_NAMES[i], (unsigned)values[i]);
+    }
+    return 0;
+  }
+
+  signal(SIGINT, onInterrupt);
+  signal(SIGTERM, onInterrupt);
+  if (!link.pushMetrics(everyMs))
+  {
+    perror(port);
+    return 1;
+  }
+  uint32_t previous[LINK_METRICS] = {};
+  bool first = true;
+  while (!interrupted)
+  {
+    memset(values, 0, sizeof(values));
+    if (link.receiveMetrics(values, LINK_METRICS, 2 * everyMs + 200) == 0)
+    {
+      continue;
+    }
+    uint32_t elapsedMs = values[LINK_METRIC_UPTIME_MS] - previous[LINK_METRIC_UPTIME_MS];
+    printf("%-24s %10s %10s\n", "metric", "value", "per s");
+    for (size_t i = 0; i < LINK_METRICS; i++)
+    {
+      if (first || !isCounter(i) || elapsedMs == 0)
+      {
+        printf("%-24s %10u\n", METRIC_NAMES[i], (unsigned)values[i]);
+      }
+      else
+      {
+        printf("%-24s %10u %10.1f\n", METRIC_NAMES[i], (unsigned)values[i],
+               (uint32_t)(values[i] - previous[i]) * 1000.0 / elapsedMs);
+      }
+    }
+    printf("\n");
+    fflush(stdout);
+    memcpy(previous, values, sizeof(previous));
+    first = false;
+  }
+  // leave the node quiet for the next tool
+  link.pushMetrics(0);
+  return 0;
+}
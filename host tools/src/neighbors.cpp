@@ -0,0 +1,89 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <link_host.h>
+#include <mac_hex.h>
+
+#define MAX_NEIGHBORS 256
+
+/**
+ * @brief prints the command line options
+ */
+static void usage(const char *program)
+{
+  fprintf(stderr,
+          "usage: %s PORT [--baud BAUD] [--every MS]\n"
+          "  PORT         serial port of the node, e.g. /dev/ttyUSB0 or /tmp/espnow/node-1\n"
+          "  --baud BAUD  current rate of the link (default 115200)\n"
+          "  --every MS   repeat every MS milliseconds instead of once\n"
+          "Prints the neighbors the node heard recently.\n",
+          program);
+}
+
+int main(int argc, char **argv)
+{
+  const char *port = nullptr;
+  uint32_t baud = 115200;
+  uint32_t everyMs = 0;
+
+  for (int i = 1; i < argc; i++)
+  {
+    if (i + 1 < argc && strcmp(argv[i], "--baud") == 0)
+    {
+      baud = strtoul(argv[++i], nullptr, 10);
+    }
+    else if (i + 1 < argc && strcmp(argv[i], "--every") == 0)
+    {
+      everyMs = strtoul(argv[++i], nullptr, 10);
+    }
+    else if (port == nullptr && argv[i][0] != '-')
+    {
+      port = argv[i];
+    }
+    else
+    {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (port == nullptr)
+  {
+    usage(argv[0]);
+    return 2;
+  }
+
+  LinkHost link;
+  if (!link.open(port, baud))
+  {
+    perror(port);
+    return 1;
+  }
+
+  static LinkNeighbor neighbors[MAX_NEIGHBORS];
+  do
+  {
+    size_t count = link.neighbors(neighbors, MAX_NEIGHBORS);
+    printf("%-12s %8s %10s %10s %6s %5s %5s\n", "mac", "age ms", "packets", "bytes", "pkt/s", "rssi", "last");
+    for (size_t i = 0; i < count && i < MAX_NEIGHBORS; i++)
+    {
+      const LinkNeighbor &n = neighbors[i];
+      char macStr[13];
+      formatMacAddress(n.macAddr, macStr);
+      printf("%-12s %8u %10u %10u %6u", macStr, (unsigned)n.ageMs, (unsigned)n.packets, (unsigned)n.bytes,
+             (unsigned)n.rate);
+      if (n.lastRssi == -128)
+      {
+        printf(" %5s %5s\n", "-", "-");
+      }
+      else
+      {
+        printf(" %5d %5d\n", n.rssi, n.lastRssi);
+      }
+    }
+    printf("%u neighbors\n\n", (unsigned)count);
+    fflush(stdout);
+    usleep(everyMs * 1000);
+  } while (everyMs > 0);
+  return 0;
+}
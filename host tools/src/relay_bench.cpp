@@ -0,0 +1,250 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <link_host.h>
+
+#define MAX_NODES 64
+#define MAGIC 0x52
+#define DRAIN_MS 1000
+
+/**
+ * @brief prints the command line options
+ */
+static void usage(const char *program)
+{
+  fprintf(stderr,
+          "usage: %s PORT... [--range N] [--count N] [--interval MS] [--size N] [--baud BAUD]\n"
+          "  PORT...         serial ports of the nodes in their order along the road, the first\n"
+          "                  one sends, e.g. /tmp/espnow/node-{1..20}\n"
+          "  --range N       radio range in positions, as given to the simulated nodes, for the\n"
+          "                  fewest hops to each node (default 0: everyone in range)\n"
+          "  --count N       messages to send (default 200)\n"
+          "  --interval MS   time between messages (default 20)\n"
+          "  --size N        payload bytes, 5 to 250 (default 64)\n"
+          "  --baud BAUD     current rate of the links (default 115200)\n"
+          "Broadcasts through the first node and prints, for each node and for each hop\n"
+          "distance, how many messages arrived and how late, then the air frames it took.\n"
+          "Build the nodes with RELAY_HOPS to reach past the first node's range.\n",
+          program);
+}
+
+static uint64_t nowUs()
+{
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/**
+ * @brief arrival time of each message at one node, 0 until it arrives
+ */
+struct Arrivals
+{
+  std::vector<uint64_t> receivedUs;
+  uint32_t duplicates;
+};
+
+static std::atomic<bool> done(false);
+
+static void receive(LinkHost *link, Arrivals *arrivals)
+{
+  while (!done.load())
+  {
+    const LinkFrame *frame = link->receive(LINK_TYPE_DATA, 50);
+    if (frame == nullptr || frame->length < 5 || frame->payload[0] != MAGIC)
+    {
+      continue;
+    }
+    uint32_t number = frame->payload[1] | frame->payload[2] << 8 | (uint32_t)frame->payload[3] << 16 |
+                      (uint32_t)frame->payload[4] << 24;
+    if (number >= arrivals->receivedUs.size())
+    {
+      continue;
+    }
+    if (arrivals->receivedUs[number] != 0)
+    {
+      arrivals->duplicates++;
+      continue;
+    }
+    arrivals->receivedUs[number] = nowUs();
+  }
+}
+
+/**
+ * @brief one node's counters, 0 if it does not answer
+ */
+static void readMetrics(LinkHost &link, uint32_t *out)
+{
+  memset(out, 0, sizeof(uint32_t) * LINK_METRICS);
+  link.metrics(out, LINK_METRICS);
+}
+
+static void printLatency(const char *label, uint32_t nodes, uint64_t expected, std::vector<uint32_t> &latencyUs)
+{
+  std::sort(latencyUs.begin(), latencyUs.end());
+  size_t n = latencyUs.size();
+  auto at = [&](double share) -> double
+  { return n == 0 ? 0 : latencyUs[std::min(n - 1, (size_t)(share * n))] / 1000.0; };
+  printf("%-8s %6u %10.1f %9.2f %9.2f %9.2f\n", label, (unsigned)nodes, expected ? 100.0 * n / expected : 0.0,
+         at(0.5), at(0.99), n ? latencyUs.back() / 1000.0 : 0.0);
+}
+
+int main(int argc, char **argv)
+{
+  const char *ports[MAX_NODES];
+  size_t nodes = 0;
+  uint32_t range = 0;
+  uint32_t count = 200;
+  uint32_t intervalMs = 20;
+  uint32_t size = 64;
+  uint32_t baud = 115200;
+
+  for (int i = 1; i < argc; i++)
+  {
+    if (i + 1 < argc && strcmp(argv[i], "--range") == 0)
+    {
+      range = strtoul(argv[++i], nullptr, 10);
+    }
+    else if (i + 1 < argc && strcmp(argv[i], "--count") == 0)
+    {
+      count = strtoul(argv[++i], nullptr, 10);
+    }
+    else if (i + 1 < argc && strcmp(argv[i], "--interval") == 0)
+    {
+      intervalMs = strtoul(argv[++i], nullptr, 10);
+    }
+    else if (i + 1 < argc && strcmp(argv[i], "--size") == 0)
+    {
+      size = strtoul(argv[++i], nullptr, 10);
+    }
+    else if (i + 1 < argc && strcmp(argv[i], "--baud") == 0)
+    {
+      baud = strtoul(argv[++i], nullptr, 10);
+    }
+    else if (nodes < MAX_NODES && argv[i][0] != '-')
+    {
+      ports[nodes++] = argv[i];
+    }
+    else
+    {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (nodes < 2 || size < 5 || size > 250 || count == 0)
+  {
+    usage(argv[0]);
+    return 2;
+  }
+
+  static LinkHost links[MAX_NODES];
+  static uint32_t before[MAX_NODES][LINK_METRICS];
+  static uint32_t after[MAX_NODES][LINK_METRICS];
+  for (size_t i = 0; i < nodes; i++)
+  {
+    if (!links[i].open(ports[i], baud))
+    {
+      perror(ports[i]);
+      return 1;
+    }
+    readMetrics(links[i], before[i]);
+  }
+
+  std::vector<Arrivals> arrivals(nodes);
+  std::vector<std::thread> receivers;
+  for (size_t i = 1; i < nodes; i++)
+  {
+    arrivals[i].receivedUs.assign(count, 0);
+    arrivals[i].duplicates = 0;
+    receivers.push_back(std::thread(receive, &links[i], &arrivals[i]));
+  }
+
+  std::vector<uint64_t> sentUs(count);
+  uint8_t payload[250];
+  memset(payload, 0, sizeof(payload));
+  payload[0] = MAGIC;
+  for (uint32_t number = 0; number < count; number++)
+  {
+    for (int b = 0; b < 4; b++)
+    {
+      payload[1 + b] = number >> (8 * b);
+    }
+    sentUs[number] = nowUs();
+    links[0].send(LINK_TYPE_DATA, payload, size);
+    usleep(intervalMs * 1000);
+  }
+  usleep(DRAIN_MS * 1000);
+  done = true;
+  for (std::thread &receiver : receivers)
+  {
+    receiver.join();
+  }
+  for (size_t i = 0; i < nodes; i++)
+  {
+    readMetrics(links[i], after[i]);
+  }
+
+  // fewest hops from the sender to each node: in range of the sender is one hop
+  auto hopsTo = [&](size_t node) -> uint32_t { return range == 0 ? 1 : (node + range - 1) / range; };
+  uint32_t maxHops = hopsTo(nodes - 1);
+  std::vector<std::vector<uint32_t>> byHop(maxHops + 1);
+  std::vector<uint32_t> nodesByHop(maxHops + 1, 0);
+  uint64_t delivered = 0;
+
+  printf("%-8s %6s %10s %9s %9s %9s %6s\n", "node", "hops", "received%", "p50 ms", "p99 ms", "max ms", "dups");
+  for (size_t i = 1; i < nodes; i++)
+  {
+    std::vector<uint32_t> latencyUs;
+    for (uint32_t number = 0; number < count; number++)
+    {
+      if (arrivals[i].receivedUs[number] != 0)
+      {
+        latencyUs.push_back(arrivals[i].receivedUs[number] - sentUs[number]);
+      }
+    }
+    delivered += latencyUs.size();
+    uint32_t hops = hopsTo(i);
+    nodesByHop[hops]++;
+    byHop[hops].insert(byHop[hops].end(), latencyUs.begin(), latencyUs.end());
+    char label[16];
+    snprintf(label, sizeof(label), "%u", (unsigned)(i + 1));
+    std::sort(latencyUs.begin(), latencyUs.end());
+    size_t n = latencyUs.size();
+    printf("%-8s %6u %10.1f %9.2f %9.2f %9.2f %6u\n", label, (unsigned)hops, 100.0 * n / count,
+           n ? latencyUs[n / 2] / 1000.0 : 0, n ? latencyUs[std::min(n - 1, n * 99 / 100)] / 1000.0 : 0,
+           n ? latencyUs.back() / 1000.0 : 0, (unsigned)arrivals[i].duplicates);
+  }
+
+  printf("\n%-8s %6s %10s %9s %9s %9s\n", "hops", "nodes", "received%", "p50 ms", "p99 ms", "max ms");
+  for (uint32_t hops = 1; hops <= maxHops; hops++)
+  {
+    char label[16];
+    snprintf(label, sizeof(label), "%u", (unsigned)hops);
+    printLatency(label, nodesByHop[hops], (uint64_t)nodesByHop[hops] * count, byHop[hops]);
+  }
+
+  uint64_t airFrames = 0;
+  uint64_t forwarded = 0;
+  uint64_t cancelled = 0;
+  uint64_t dropped = 0;
+  for (size_t i = 0; i < nodes; i++)
+  {
+    airFrames += after[i][LINK_METRIC_TX_OK] - before[i][LINK_METRIC_TX_OK];
+    forwarded += after[i][LINK_METRIC_RELAY_FORWARDED] - before[i][LINK_METRIC_RELAY_FORWARDED];
+    cancelled += after[i][LINK_METRIC_RELAY_CANCELLED] - before[i][LINK_METRIC_RELAY_CANCELLED];
+    dropped += after[i][LINK_METRIC_RELAY_DROPPED] - before[i][LINK_METRIC_RELAY_DROPPED];
+  }
+  // a line of nodes needs one re-air per hop past the first
+  uint32_t needed = maxHops - 1;
+  printf("\ncoverage %.1f%%, air frames per message %.2f (re-airs %.2f, fewest needed %u, redundant %.2f),\n"
+         "re-airs given up %.2f, not scheduled for lack of a slot %.2f\n",
+         100.0 * delivered / ((nodes - 1) * (uint64_t)count), (double)airFrames / count, (double)forwarded / count,
+         (unsigned)needed, (double)forwarded / count - needed, (double)cancelled / count, (double)dropped / count);
+  return 0;
+}
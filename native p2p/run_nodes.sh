@@ -0,0 +1,22 @@
+#!/bin/sh
+# Starts N simulated nodes sharing one simulated air.
+# Node i gets mac 02:00:00:00:00:i and its serial port at $DIR/node-i.
+# Further arguments go to every node, e.g. --range 3.
+# BINARY picks another build, e.g. BINARY=.pio/build/native_relay/program
+#
+# usage: ./run_nodes.sh [N] [DIR] [NODE OPTIONS...]
+
+COUNT=${1:-4}
+DIR=${2:-/tmp/espnow}
+BINARY=${BINARY:-.pio/build/native/program}
+if [ $# -ge 2 ]; then shift 2; else shift $#; fi
+
+mkdir -p "$DIR"
+trap 'kill 0' INT TERM EXIT
+
+i=1
+while [ "$i" -le "$COUNT" ]; do
+  "$BINARY" --id "$i" --link "$DIR/node-$i" "$@" &
+  i=$((i + 1))
+done
+wait
@@ -0,0 +1,78 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <dedup_table.h>
+
+#define FRAMES 4000000
+
+/**
+ * @brief small fast generator, the benchmark should not measure rand()
+ */
+static uint32_t nextRandom()
+{
+  static uint32_t state = 2463534242u;
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+static double nowNs()
+{
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+/**
+ * @brief feeds FRAMES frames from `senders` random senders, 1 in 10 a replay
+ * of a recent frame, and prints the cost per lookup
+ */
+template <size_t Capacity>
+static void run(uint32_t senders)
+{
+  DedupTable<Capacity> &table = *new DedupTable<Capacity>(10000);
+  uint16_t *sequence = (uint16_t *)calloc(senders, sizeof(uint16_t));
+  uint8_t macAddr[6] = {0x24, 0x6F, 0x28, 0, 0, 0};
+  uint32_t replays = 0;
+  uint32_t rejected = 0;
+
+  double start = nowNs();
+  for (uint32_t frame = 0; frame < FRAMES; frame++)
+  {
+    uint32_t sender = nextRandom() % senders;
+    macAddr[3] = sender >> 16;
+    macAddr[4] = sender >> 8;
+    macAddr[5] = sender;
+    uint16_t seq = sequence[sender];
+    if (seq > 0 && nextRandom() % 10 == 0)
+    {
+      seq -= 1 + nextRandom() % (seq < 8 ? seq : 8);
+      replays++;
+    }
+    else
+    {
+      sequence[sender]++;
+    }
+    rejected += !table.accept(macAddr, seq, frame / 1000);
+  }
+  double elapsed = nowNs() - start;
+
+  printf("%6u senders  table %5u  %6.1f ns/frame  replays %7u  rejected %7u  evictions %7u\n", (unsigned)senders,
+         (unsigned)Capacity, elapsed / FRAMES, (unsigned)replays, (unsigned)rejected, (unsigned)table.evictions);
+  free(sequence);
+  delete &table;
+}
+
+int main()
+{
+  run<64>(16);
+  run<64>(48);
+  run<512>(300);
+  run<8192>(1000);
+  run<8192>(3000);
+  run<8192>(6000);
+  // more senders than the table holds: every miss evicts
+  run<8192>(12000);
+  return 0;
+}
@@ -0,0 +1,222 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <channel_hopper.h>
+#include <relay.h>
+
+/*
+ * Mocked radio under ChannelHopper: nodes on one virtual clock, each with its
+ * own boot time and a crystal up to DRIFT_PPM off. A sync frame reaches every
+ * node in range that is on the sender's channel AIR_US after it is sent.
+ * Prints how long the nodes take to agree on the network time within the
+ * guard, how far apart they stay, the sync frames sent and the share of time
+ * they all sit on the same channel. The schedule is the one of relay.h.
+ */
+
+#define STEP_US 100
+#define AIR_US 400
+#define DRIFT_PPM 20
+#define SECONDS 60
+
+static const uint8_t SERVICE_CHANNEL_LIST[] = {SERVICE_CHANNELS};
+typedef ChannelHopper<sizeof(SERVICE_CHANNEL_LIST)> Hopper;
+
+/**
+ * @brief small fast generator, the simulation should not depend on rand()
+ */
+static uint32_t nextRandom()
+{
+  static uint32_t state = 2463534242u;
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+struct Node
+{
+  Hopper *hopper;
+  uint64_t bootUs;
+  double rate; /**< local microseconds per real one */
+  int group;   /**< nodes only hear their group until the groups meet */
+  bool up;
+  uint8_t channel;
+
+  uint32_t localUs(uint64_t nowUs) const { return (uint32_t)((nowUs - bootUs) * rate); }
+};
+
+struct SyncFrame
+{
+  uint64_t arrivesUs;
+  uint32_t networkUs;
+  uint8_t channel;
+  size_t sender;
+};
+
+struct Result
+{
+  double syncedMs;   /**< from the last boot or the groups meeting until the clocks stay within the guard, < 0 never */
+  uint32_t spreadUs; /**< largest gap between two clocks over the last second */
+  double framesPerS;
+  double togetherPct; /**< time every node is on the same channel, once synced */
+};
+
+/**
+ * @param bootSpreadUs nodes boot at random within this time
+ * @param groups separate groups, group g boots g * groupPhaseUs after group 0 and only hears
+ * itself until meetUs
+ * @param rescan CHANNEL_RESCAN of every node
+ */
+static Result run(size_t count, uint64_t bootSpreadUs, int groups, uint64_t groupPhaseUs, uint64_t meetUs,
+                  uint32_t rescan)
+{
+  std::vector<Node> nodes(count);
+  for (size_t i = 0; i < count; i++)
+  {
+    Node &node = nodes[i];
+    node.hopper = new Hopper(RADIO_CHANNEL, SERVICE_CHANNEL_LIST, CHANNEL_SYNC_MS * 1000, CHANNEL_CONTROL_MS * 1000,
+                             CHANNEL_GUARD_US, rescan);
+    node.group = i % groups;
+    // the first node of each group boots first, its clock leads the group
+    node.bootUs = node.group * groupPhaseUs + (i < (size_t)groups ? 0 : 1 + nextRandom() % bootSpreadUs);
+    node.rate = 1 + ((int32_t)(nextRandom() % (2 * DRIFT_PPM + 1)) - DRIFT_PPM) * 1e-6;
+    node.up = false;
+    node.channel = RADIO_CHANNEL;
+  }
+  uint64_t settledUs = 0;
+  for (const Node &node : nodes)
+  {
+    settledUs = node.bootUs > settledUs ? node.bootUs : settledUs;
+  }
+  settledUs = meetUs > settledUs ? meetUs : settledUs;
+
+  std::vector<SyncFrame> air;
+  uint64_t lastApartUs = 0;
+  uint32_t spreadUs = 0;
+  uint64_t frames = 0;
+  uint64_t togetherSteps = 0;
+  uint64_t syncedSteps = 0;
+  const uint64_t endUs = (uint64_t)SECONDS * 1000000;
+  for (uint64_t nowUs = 0; nowUs < endUs; nowUs += STEP_US)
+  {
+    for (size_t i = 0; i < count; i++)
+    {
+      Node &node = nodes[i];
+      if (!node.up && nowUs >= node.bootUs)
+      {
+        node.up = true;
+        node.hopper->begin(node.localUs(nowUs), 2 * CHANNEL_SYNC_MS * 1000, nextRandom());
+      }
+      if (!node.up)
+      {
+        continue;
+      }
+      uint32_t localUs = node.localUs(nowUs);
+      node.channel = node.hopper->slot(localUs).channel;
+      if (node.hopper->beaconDue(localUs, nextRandom()))
+      {
+        SyncFrame frame = {nowUs + AIR_US, node.hopper->networkUs(localUs), node.channel, i};
+        air.push_back(frame);
+        frames++;
+      }
+    }
+
+    for (size_t f = 0; f < air.size();)
+    {
+      const SyncFrame &frame = air[f];
+      if (frame.arrivesUs > nowUs)
+      {
+        f++;
+        continue;
+      }
+      for (size_t i = 0; i < count; i++)
+      {
+        Node &node = nodes[i];
+        if (i != frame.sender && node.up && node.channel == frame.channel &&
+            (nowUs >= meetUs || node.group == nodes[frame.sender].group))
+        {
+          node.hopper->heard(frame.networkUs, node.localUs(nowUs));
+        }
+      }
+      air.erase(air.begin() + f);
+    }
+
+    // clocks relative to the first node, the spread is the widest gap between two
+    int32_t lowest = 0;
+    int32_t highest = 0;
+    bool together = true;
+    uint32_t first = nodes[0].hopper->networkUs(nodes[0].localUs(nowUs));
+    for (const Node &node : nodes)
+    {
+      if (node.up)
+      {
+        int32_t gap = (int32_t)(node.hopper->networkUs(node.localUs(nowUs)) - first);
+        lowest = gap < lowest ? gap : lowest;
+        highest = gap > highest ? gap : highest;
+      }
+      together &= node.up && node.channel == nodes[0].channel;
+    }
+    uint32_t spread = highest - lowest;
+    if (spread >= CHANNEL_GUARD_US || nowUs < settledUs)
+    {
+      lastApartUs = nowUs;
+    }
+    if (nowUs >= endUs - 1000000 && spread > spreadUs)
+    {
+      spreadUs = spread;
+    }
+    if (lastApartUs != nowUs)
+    {
+      syncedSteps++;
+      togetherSteps += together;
+    }
+  }
+
+  Result result;
+  result.syncedMs = lastApartUs + STEP_US >= endUs ? -1 : (lastApartUs + STEP_US - settledUs) / 1000.0;
+  result.spreadUs = spreadUs;
+  result.framesPerS = frames / (double)SECONDS;
+  result.togetherPct = syncedSteps ? 100.0 * togetherSteps / syncedSteps : 0;
+  for (Node &node : nodes)
+  {
+    delete node.hopper;
+  }
+  return result;
+}
+
+static void print(const char *name, size_t count, uint32_t rescan, Result result)
+{
+  char synced[16];
+  if (result.syncedMs < 0)
+  {
+    snprintf(synced, sizeof(synced), "never");
+  }
+  else
+  {
+    snprintf(synced, sizeof(synced), "%.1f", result.syncedMs);
+  }
+  printf("%-28s %5u %6u %11s %9u %9.1f %10.1f\n", name, (unsigned)count, (unsigned)rescan, synced,
+         (unsigned)result.spreadUs, result.framesPerS, result.togetherPct);
+}
+
+int main()
+{
+  printf("sync interval %u ms, control part %u ms, guard %u us, %u service channels, %u s per run\n",
+         CHANNEL_SYNC_MS, CHANNEL_CONTROL_MS, CHANNEL_GUARD_US, (unsigned)sizeof(SERVICE_CHANNEL_LIST), SECONDS);
+  printf("synced: ms from the last boot, or the groups meeting, until every clock stays within the guard\n");
+  printf("%-28s %5s %6s %11s %9s %9s %10s\n", "scenario", "nodes", "rescan", "synced ms", "spread us", "sync/s",
+         "together %");
+  const size_t counts[] = {2, 10, 50};
+  for (size_t count : counts)
+  {
+    print("boot within 1 s", count, CHANNEL_RESCAN, run(count, 1000000, 1, 0, 0, CHANNEL_RESCAN));
+  }
+  // two groups whose control parts never overlap, in range of each other after 2 s
+  const uint64_t halfUs = CHANNEL_SYNC_MS * 500;
+  const uint32_t rescans[] = {0, 50, CHANNEL_RESCAN};
+  for (uint32_t rescan : rescans)
+  {
+    print("2 groups half a cycle apart", 20, rescan, run(20, 500000, 2, halfUs, 2000000, rescan));
+  }
+  return 0;
+}
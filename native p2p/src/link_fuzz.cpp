@@ -0,0 +1,177 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <link_protocol.h>
+
+/*
+ * LinkParser on a damaged host link: FRAMES frames of every type and size,
+ * with or without a mac, then bytes dropped, flipped or inserted at random
+ * like a UART overrun or line noise, fed in random chunks. A frame that no
+ * damage touched has to come out, in order and intact, and nothing else may:
+ * the parser has to drop the damaged bytes and find the next sync word. The
+ * stream is random on purpose, sync words and plausible headers turn up
+ * inside payloads as well. Prints the frames recovered for each damage rate
+ * and exits with 1 on an intact frame missing, a frame repeated or out of
+ * order, or more bogus frames than the crc lets through. Also worth running
+ * built with -fsanitize=address,undefined.
+ */
+
+#define FRAMES 100000
+#define QUEUE_SIZE 8
+
+/**
+ * @brief small fast generator, the test should not depend on rand()
+ */
+static uint32_t nextRandom()
+{
+  static uint32_t state = 2463534242u;
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+struct Sent
+{
+  uint8_t type;
+  bool hasMac;
+  uint16_t length;
+  size_t payloadAt; /**< in payloads */
+  bool damaged;
+};
+
+/**
+ * @param permille bytes out of 1000 dropped, flipped or inserted, a third each
+ * @param maxChunk chunks are 1 to maxChunk bytes
+ */
+static bool run(uint32_t permille, size_t maxChunk)
+{
+  const uint8_t macAddr[LINK_MAC_LEN] = {0x24, 0x6F, 0x28, 0x01, 0x02, 0x03};
+  std::vector<Sent> sent(FRAMES);
+  std::vector<uint8_t> payloads;
+  std::vector<uint8_t> stream;
+  uint8_t encoded[LINK_MAX_FRAME];
+  for (Sent &frame : sent)
+  {
+    frame.type = 1 + nextRandom() % 31;
+    frame.hasMac = nextRandom() % 2;
+    // mostly short frames, some up to the largest. The payload starts with the frame's number
+    frame.length = 4 + (nextRandom() % 8 == 0 ? nextRandom() % (LINK_MAX_PAYLOAD - 3) : nextRandom() % 60);
+    frame.payloadAt = payloads.size();
+    uint32_t number = &frame - &sent[0];
+    for (uint16_t i = 0; i < frame.length; i++)
+    {
+      payloads.push_back(i < 4 ? number >> (8 * i) : nextRandom());
+    }
+    size_t n = linkEncode(encoded, frame.type, frame.hasMac ? macAddr : nullptr, &payloads[frame.payloadAt],
+                          frame.length, nextRandom() % LINK_PRIORITIES);
+    frame.damaged = false;
+    for (size_t i = 0; i < n; i++)
+    {
+      uint32_t damage = nextRandom() % 3000;
+      if (damage >= 3 * permille)
+      {
+        stream.push_back(encoded[i]);
+      }
+      else if (damage < permille)
+      {
+        // dropped
+        frame.damaged = true;
+      }
+      else if (damage < 2 * permille)
+      {
+        stream.push_back(encoded[i] ^ (1 << nextRandom() % 8));
+        frame.damaged = true;
+      }
+      else
+      {
+        // inserted in front of the byte, may be a sync byte. Before the first
+        // byte it leaves the frame alone
+        stream.push_back(nextRandom() % 2 ? LINK_SYNC0 : nextRandom());
+        stream.push_back(encoded[i]);
+        frame.damaged |= i > 0;
+      }
+    }
+  }
+
+  // later traffic: a damaged header may claim a long frame and hold the
+  // frames after it until that many bytes came in
+  stream.insert(stream.end(), LINK_MAX_FRAME, 0);
+
+  LinkParser<QUEUE_SIZE> &parser = *new LinkParser<QUEUE_SIZE>();
+  size_t next = 0;
+  uint32_t recovered = 0;
+  uint32_t intact = 0;
+  uint32_t bogus = 0;
+  uint32_t lost = 0;
+  for (size_t offset = 0; offset < stream.size();)
+  {
+    size_t chunk = 1 + nextRandom() % maxChunk;
+    chunk = chunk < stream.size() - offset ? chunk : stream.size() - offset;
+    // the parser takes less than the chunk while its frame queue is full
+    for (size_t fed = 0; fed < chunk;)
+    {
+      fed += parser.feed(&stream[offset + fed], chunk - fed);
+      for (const LinkFrame *decoded = parser.front(); decoded != nullptr; decoded = parser.front())
+      {
+        uint32_t number = 0;
+        for (int i = 0; i < 4 && i < decoded->length; i++)
+        {
+          number |= (uint32_t)decoded->payload[i] << (8 * i);
+        }
+        const Sent *frame = number < sent.size() ? &sent[number] : nullptr;
+        if (frame == nullptr || number < next || decoded->type != frame->type || decoded->length != frame->length ||
+            ((decoded->flags & LINK_FLAG_MAC) != 0) != frame->hasMac ||
+            (frame->hasMac && memcmp(decoded->macAddr, macAddr, LINK_MAC_LEN) != 0) ||
+            memcmp(decoded->payload, &payloads[frame->payloadAt], decoded->length) != 0)
+        {
+          bogus++;
+        }
+        else
+        {
+          // damaged frames may be skipped, intact ones not
+          for (; next < number; next++)
+          {
+            lost += !sent[next].damaged;
+          }
+          next++;
+          recovered++;
+        }
+        parser.pop();
+      }
+    }
+    offset += chunk;
+  }
+  for (; next < sent.size(); next++)
+  {
+    lost += !sent[next].damaged;
+  }
+  for (const Sent &frame : sent)
+  {
+    intact += !frame.damaged;
+  }
+
+  // a crc-16 lets one damaged candidate in 65536 through, and a bogus frame
+  // may swallow intact ones after it. Fail on more than twice as many as
+  // expected, or on an intact frame lost without one
+  bool ok = bogus * 65536 <= 2 * (parser.crcErrors + bogus) + 65536 && (lost == 0 || bogus > 0);
+  printf("damage %2u/1000  chunks 1-%-4u  intact %6u  recovered %6u  lost %3u  bogus %3u  crc errors %6u  "
+         "skipped %8u  %s\n",
+         (unsigned)permille, (unsigned)maxChunk, (unsigned)intact, (unsigned)recovered, (unsigned)lost,
+         (unsigned)bogus, (unsigned)parser.crcErrors, (unsigned)parser.droppedBytes, ok ? "ok" : "FAILED");
+  delete &parser;
+  return ok;
+}
+
+int main()
+{
+  bool ok = true;
+  ok = run(0, 64) && ok;
+  ok = run(1, 1) && ok;
+  ok = run(1, 64) && ok;
+  ok = run(1, 2048) && ok;
+  ok = run(10, 64) && ok;
+  ok = run(50, 64) && ok;
+  return ok ? 0 : 1;
+}
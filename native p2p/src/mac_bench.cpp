@@ -0,0 +1,85 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <mac_hex.h>
+
+/*
+ * formatMacAddress against the snprintf it replaced, on the same macs. Prints
+ * the nanoseconds per call of both and exits with 1 if they ever disagree.
+ */
+
+#define CALLS 4000000
+
+/**
+ * @brief small fast generator, the benchmark should not measure rand()
+ */
+static uint32_t nextRandom()
+{
+  static uint32_t state = 2463534242u;
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+static double nowNs()
+{
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+/**
+ * @brief the former formatMacAddress of both firmwares
+ */
+static void formatMacAddressSnprintf(const uint8_t *macAddr, char *buffer)
+{
+  snprintf(buffer, 13, "%02x%02x%02x%02x%02x%02x", macAddr[0], macAddr[1], macAddr[2], macAddr[3], macAddr[4],
+           macAddr[5]);
+}
+
+/**
+ * @return ns per call, sums the characters into checksum so nothing is optimized away
+ */
+template <typename Format>
+static double timeCalls(const uint8_t (*macs)[6], size_t count, Format format, uint32_t *checksum)
+{
+  char buffer[13];
+  double start = nowNs();
+  for (uint32_t call = 0; call < CALLS; call++)
+  {
+    format(macs[call % count], buffer);
+    *checksum += buffer[call % 12];
+  }
+  return (nowNs() - start) / CALLS;
+}
+
+int main()
+{
+  static uint8_t macs[1024][6];
+  for (auto &macAddr : macs)
+  {
+    for (uint8_t &part : macAddr)
+    {
+      part = nextRandom();
+    }
+  }
+
+  bool ok = true;
+  char expected[13];
+  char actual[13];
+  for (const auto &macAddr : macs)
+  {
+    formatMacAddressSnprintf(macAddr, expected);
+    formatMacAddress(macAddr, actual);
+    ok = ok && memcmp(expected, actual, sizeof(expected)) == 0;
+  }
+
+  uint32_t before = 0;
+  uint32_t after = 0;
+  double snprintfNs = timeCalls(macs, 1024, formatMacAddressSnprintf, &before);
+  double tableNs = timeCalls(macs, 1024, formatMacAddress, &after);
+  printf("snprintf %7.1f ns/call\ntable    %7.1f ns/call\n%s\n", snprintfNs, tableNs,
+         ok && before == after ? "same output" : "DIFFERENT OUTPUT");
+  return ok && before == after ? 0 : 1;
+}
@@ -0,0 +1,65 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <relay.h>
+#include <hal.h>
+
+/**
+ * @brief prints the command line options
+ */
+static void usage(const char *program)
+{
+  fprintf(stderr,
+          "usage: %s [--id N] [--group ADDR] [--port PORT] [--link PATH] [--range N] [--airtime]\n"
+          "  --id N        node number, mac becomes 02:00:00:00:hi(N):lo(N) (default 1)\n"
+          "  --group ADDR  multicast group used as the air (default 239.255.42.1)\n"
+          "  --port PORT   udp port of the air (default 42042)\n"
+          "  --link PATH   symlink to create to the node's serial pty\n"
+          "  --range N     hear only nodes with ids at most N away, as if the ids were\n"
+          "                positions along a road (default 0: every node hears every other)\n"
+          "  --airtime     frames take their time on the air at 1 Mbit/s, wait for it to be\n"
+          "                free and collide when they overlap, every node of a run needs it\n",
+          program);
+}
+
+int main(int argc, char **argv)
+{
+  for (int i = 1; i < argc; i++)
+  {
+    if (i + 1 < argc && strcmp(argv[i], "--id") == 0)
+    {
+      linuxConfig.nodeId = atoi(argv[++i]);
+    }
+    else if (i + 1 < argc && strcmp(argv[i], "--group") == 0)
+    {
+      linuxConfig.group = argv[++i];
+    }
+    else if (i + 1 < argc && strcmp(argv[i], "--port") == 0)
+    {
+      linuxConfig.port = atoi(argv[++i]);
+    }
+    else if (i + 1 < argc && strcmp(argv[i], "--link") == 0)
+    {
+      linuxConfig.serialLink = argv[++i];
+    }
+    else if (i + 1 < argc && strcmp(argv[i], "--range") == 0)
+    {
+      linuxConfig.range = atoi(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--airtime") == 0)
+    {
+      linuxConfig.airtime = true;
+    }
+    else
+    {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+
+  relaySetup();
+  for (;;)
+  {
+    relayLoop();
+  }
+}
@@ -0,0 +1,104 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <algorithm>
+#include <neighbor_table.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#define UPDATES 4000000
+#define SAMPLES 200000
+
+/**
+ * @brief small fast generator, the benchmark should not measure rand()
+ */
+static uint32_t nextRandom()
+{
+  static uint32_t state = 2463534242u;
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+static double nowNs()
+{
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+/**
+ * @brief cycle counter where there is one, nanoseconds elsewhere
+ */
+static uint64_t ticks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return nowNs();
+#endif
+}
+
+static void macOf(uint32_t sender, uint8_t *macAddr)
+{
+  macAddr[0] = 0x24;
+  macAddr[1] = 0x6F;
+  macAddr[2] = 0x28;
+  macAddr[3] = sender >> 16;
+  macAddr[4] = sender >> 8;
+  macAddr[5] = sender;
+}
+
+/**
+ * @brief UPDATES updates from random senders for the average, then SAMPLES
+ * individually timed ones for the spread
+ */
+template <size_t Capacity>
+static void run(uint32_t senders)
+{
+  NeighborTable<Capacity> &table = *new NeighborTable<Capacity>(5000);
+  uint8_t macAddr[6];
+
+  double start = nowNs();
+  for (uint32_t i = 0; i < UPDATES; i++)
+  {
+    macOf(nextRandom() % senders, macAddr);
+    table.update(macAddr, -40 - (int)(macAddr[5] & 31), 64, i / 1000);
+  }
+  double average = (nowNs() - start) / UPDATES;
+
+  static uint32_t samples[SAMPLES];
+  for (uint32_t i = 0; i < SAMPLES; i++)
+  {
+    macOf(nextRandom() % senders, macAddr);
+    uint64_t before = ticks();
+    table.update(macAddr, -60, 64, UPDATES / 1000 + i / 1000);
+    samples[i] = ticks() - before;
+  }
+  std::sort(samples, samples + SAMPLES);
+
+  printf("%6u senders  table %5u  %5.1f ns/update  ticks p50 %4u p99 %4u p99.9 %5u  evictions %8u\n",
+         (unsigned)senders, (unsigned)Capacity, average, (unsigned)samples[SAMPLES / 2],
+         (unsigned)samples[SAMPLES * 99 / 100], (unsigned)samples[SAMPLES * 999 / 1000], (unsigned)table.evictions);
+  delete &table;
+}
+
+int main()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  printf("ticks are TSC cycles, including about 20 of rdtsc itself\n");
+#else
+  printf("ticks are nanoseconds\n");
+#endif
+  run<32>(16);
+  run<128>(64);
+  run<128>(100);
+  run<256>(200);
+  run<1024>(800);
+  // more senders than slots: most updates evict
+  run<128>(1000);
+  run<1024>(8000);
+  return 0;
+}
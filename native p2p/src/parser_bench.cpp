@@ -0,0 +1,124 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+#include <link_protocol.h>
+
+/*
+ * LinkParser on a synthetic host link stream: FRAMES data frames of 1 to 250
+ * bytes, one in four with a mac, fed in chunks of random size like the bytes
+ * a serial port has buffered at each pass of loop(). Every frame is popped as
+ * soon as it is decoded and compared with the one sent. Prints the frames
+ * and megabytes per second for each chunk size, exits with 1 if a frame came
+ * out different or missing.
+ */
+
+#define FRAMES 200000
+#define QUEUE_SIZE 8
+
+/**
+ * @brief small fast generator, the benchmark should not measure rand()
+ */
+static uint32_t nextRandom()
+{
+  static uint32_t state = 2463534242u;
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+static double nowNs()
+{
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+static void payloadOf(uint32_t frame, uint8_t *payload, uint16_t length)
+{
+  for (uint16_t i = 0; i < length; i++)
+  {
+    payload[i] = frame * 31 + i;
+  }
+}
+
+static uint16_t lengthOf(uint32_t frame)
+{
+  return 1 + frame * 7919 % 250;
+}
+
+/**
+ * @param maxChunk chunks are 1 to maxChunk bytes
+ */
+static bool run(const std::vector<uint8_t> &stream, size_t maxChunk)
+{
+  LinkParser<QUEUE_SIZE> &parser = *new LinkParser<QUEUE_SIZE>();
+  std::vector<size_t> chunks;
+  for (size_t offset = 0; offset < stream.size();)
+  {
+    size_t chunk = 1 + nextRandom() % maxChunk;
+    chunks.push_back(chunk < stream.size() - offset ? chunk : stream.size() - offset);
+    offset += chunks.back();
+  }
+
+  uint8_t expected[LINK_MAX_PAYLOAD];
+  uint32_t frame = 0;
+  bool ok = true;
+  double start = nowNs();
+  size_t offset = 0;
+  for (size_t chunk : chunks)
+  {
+    // the parser takes less than the chunk while its frame queue is full
+    for (size_t fed = 0; fed < chunk;)
+    {
+      fed += parser.feed(&stream[offset + fed], chunk - fed);
+      for (const LinkFrame *decoded = parser.front(); decoded != nullptr; decoded = parser.front())
+      {
+        uint16_t length = lengthOf(frame);
+        payloadOf(frame, expected, length);
+        if (decoded->type != LINK_TYPE_DATA || decoded->length != length ||
+            ((decoded->flags & LINK_FLAG_MAC) != 0) != (frame % 4 == 0) ||
+            memcmp(decoded->payload, expected, length) != 0)
+        {
+          ok = false;
+        }
+        parser.pop();
+        frame++;
+      }
+    }
+    offset += chunk;
+  }
+  double elapsed = nowNs() - start;
+
+  ok = ok && frame == FRAMES && parser.crcErrors == 0 && parser.droppedBytes == 0;
+  printf("chunks 1-%-5u %9.0f frames/s %8.1f MB/s  decoded %6u  %s\n", (unsigned)maxChunk, FRAMES / elapsed * 1e9,
+         stream.size() / elapsed * 1e3, (unsigned)frame, ok ? "ok" : "FAILED");
+  delete &parser;
+  return ok;
+}
+
+int main()
+{
+  const uint8_t macAddr[LINK_MAC_LEN] = {0x24, 0x6F, 0x28, 0x01, 0x02, 0x03};
+  std::vector<uint8_t> stream;
+  uint8_t payload[LINK_MAX_PAYLOAD];
+  uint8_t encoded[LINK_MAX_FRAME];
+  for (uint32_t frame = 0; frame < FRAMES; frame++)
+  {
+    uint16_t length = lengthOf(frame);
+    payloadOf(frame, payload, length);
+    size_t n = linkEncode(encoded, LINK_TYPE_DATA, frame % 4 == 0 ? macAddr : nullptr, payload, length);
+    stream.insert(stream.end(), encoded, encoded + n);
+  }
+  printf("%u frames of 1 to 250 bytes, %u bytes on the link\n", (unsigned)FRAMES, (unsigned)stream.size());
+
+  bool ok = true;
+  // a few bytes per pass like a fast loop(), up to a full UART buffer
+  for (size_t maxChunk : {16, 64, 256, 1024, 4096})
+  {
+    ok = run(stream, maxChunk) && ok;
+  }
+  return ok ? 0 : 1;
+}
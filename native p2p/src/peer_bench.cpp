@@ -0,0 +1,172 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include <hal.h>
+#include <peer_cache.h>
+
+/*
+ * PeerCache on a mocked radio that holds the ESP-NOW limits: at most
+ * RADIO_MAX_PEERS peers, RADIO_MAX_ENCRYPTED_PEERS of them with a key. The
+ * host unicasts to destinations picked with a Zipf law, the first ones the
+ * most often, and has set the keys of the most frequent ones. Prints the hit
+ * rate, the radio calls per send against the two of adding and removing the
+ * peer around every send, and anything the mocked radio had to refuse,
+ * which should be nothing.
+ */
+
+#define SENDS 1000000
+#define KEYS 16
+
+/**
+ * @brief small fast generator, the benchmark should not measure rand()
+ */
+static uint32_t nextRandom()
+{
+  static uint32_t state = 2463534242u;
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+struct MockRadio
+{
+  static std::vector<std::vector<uint8_t>> peers;
+  static size_t encrypted;
+  static std::vector<bool> keyed;
+  static uint32_t calls;
+  static uint32_t refused;
+
+  static int find(const uint8_t *macAddr)
+  {
+    for (size_t i = 0; i < peers.size(); i++)
+    {
+      if (memcmp(peers[i].data(), macAddr, 6) == 0)
+      {
+        return i;
+      }
+    }
+    return -1;
+  }
+
+  static bool addPeer(const uint8_t *macAddr, const uint8_t *lmk)
+  {
+    calls++;
+    if (find(macAddr) >= 0 || peers.size() == RADIO_MAX_PEERS ||
+        (lmk != nullptr && encrypted == RADIO_MAX_ENCRYPTED_PEERS))
+    {
+      refused++;
+      return false;
+    }
+    peers.push_back(std::vector<uint8_t>(macAddr, macAddr + 6));
+    keyed.push_back(lmk != nullptr);
+    encrypted += lmk != nullptr;
+    return true;
+  }
+
+  static bool removePeer(const uint8_t *macAddr)
+  {
+    calls++;
+    int index = find(macAddr);
+    if (index < 0)
+    {
+      refused++;
+      return false;
+    }
+    encrypted -= keyed[index];
+    peers.erase(peers.begin() + index);
+    keyed.erase(keyed.begin() + index);
+    return true;
+  }
+};
+
+std::vector<std::vector<uint8_t>> MockRadio::peers;
+size_t MockRadio::encrypted = 0;
+std::vector<bool> MockRadio::keyed;
+uint32_t MockRadio::calls = 0;
+uint32_t MockRadio::refused = 0;
+
+typedef PeerCache<MockRadio, KEYS, RADIO_MAX_PEERS, RADIO_MAX_ENCRYPTED_PEERS> Cache;
+
+static void macOf(uint32_t destination, uint8_t *macAddr)
+{
+  macAddr[0] = 0x24;
+  macAddr[1] = 0x6F;
+  macAddr[2] = 0x28;
+  macAddr[3] = destination >> 16;
+  macAddr[4] = destination >> 8;
+  macAddr[5] = destination;
+}
+
+/**
+ * @param destinations nodes the host sends to
+ * @param keyed the most frequent ones that have a key
+ */
+static void run(uint32_t destinations, uint32_t keyed)
+{
+  MockRadio::peers.clear();
+  MockRadio::keyed.clear();
+  MockRadio::encrypted = 0;
+  MockRadio::calls = 0;
+  MockRadio::refused = 0;
+  Cache &cache = *new Cache();
+  const uint8_t broadcast[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+  cache.pin(broadcast);
+
+  uint8_t macAddr[6];
+  uint8_t lmk[PEER_KEY_LEN] = {};
+  uint32_t keysRefused = 0;
+  for (uint32_t d = 0; d < keyed; d++)
+  {
+    macOf(d, macAddr);
+    keysRefused += !cache.setKey(macAddr, lmk);
+  }
+  uint32_t setupCalls = MockRadio::calls;
+
+  // zipf law with exponent 1
+  std::vector<double> cumulative(destinations);
+  double total = 0;
+  for (uint32_t d = 0; d < destinations; d++)
+  {
+    total += 1.0 / (d + 1);
+    cumulative[d] = total;
+  }
+  uint32_t failed = 0;
+  size_t mostPeers = 0;
+  size_t mostEncrypted = 0;
+  for (uint32_t send = 0; send < SENDS; send++)
+  {
+    double pick = (nextRandom() + 0.5) / 4294967296.0 * total;
+    uint32_t destination = std::lower_bound(cumulative.begin(), cumulative.end(), pick) - cumulative.begin();
+    macOf(destination < destinations ? destination : destinations - 1, macAddr);
+    failed += !cache.acquire(macAddr);
+    mostPeers = MockRadio::peers.size() > mostPeers ? MockRadio::peers.size() : mostPeers;
+    mostEncrypted = MockRadio::encrypted > mostEncrypted ? MockRadio::encrypted : mostEncrypted;
+  }
+
+  printf("%6u %6u %8.2f %12.3f %10u %8u %7u/%u %10u %8u\n", (unsigned)destinations, (unsigned)keyed,
+         100.0 * cache.hits / (cache.hits + cache.misses), (double)(MockRadio::calls - setupCalls) / SENDS,
+         (unsigned)cache.evictions, (unsigned)failed + keysRefused, (unsigned)mostPeers, (unsigned)mostEncrypted,
+         (unsigned)MockRadio::refused, (unsigned)cache.failed);
+  delete &cache;
+}
+
+int main()
+{
+  printf("%u unicast sends per line, %u peers of which %u encrypted, broadcast pinned; without a cache a send\n"
+         "costs 2 radio calls (add and remove its peer)\n",
+         (unsigned)SENDS, (unsigned)RADIO_MAX_PEERS, (unsigned)RADIO_MAX_ENCRYPTED_PEERS);
+  printf("%6s %6s %8s %12s %10s %8s %9s %10s %8s\n", "nodes", "keyed", "hit%", "calls/send", "evictions",
+         "failed", "peers/enc", "refused", "cache");
+  run(8, 0);
+  run(19, 0);
+  run(19, 6);
+  run(30, 0);
+  run(30, 6);
+  run(50, 12);
+  run(200, 0);
+  run(200, 16);
+  return 0;
+}
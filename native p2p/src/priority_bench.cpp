@@ -0,0 +1,181 @@
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include <tx_queue.h>
+
+/*
+ * Simulated radio in front of TxQueue: one frame on the air at a time, at
+ * the 1 Mbit/s ESP-NOW broadcasts use, and a FIFO of up to TX_WINDOW frames
+ * handed to the radio. Urgent messages arrive at a steady 10 per second
+ * while bulk messages arrive at random at a growing share of what the air
+ * carries. Prints the latency of the urgent messages from queueing to the
+ * end of their transmission.
+ */
+
+#define SECONDS 60
+#define DEPTH 16
+#define WINDOW 4
+#define URGENT_PER_SECOND 10
+#define URGENT_LENGTH 64
+#define BULK_LENGTH 200
+
+/**
+ * @brief microseconds on the air: long preamble, then mac header, action
+ * frame and vendor element overhead (43 bytes) and the payload at 1 Mbit/s
+ */
+static uint32_t airtimeUs(size_t length)
+{
+  return 192 + (43 + length) * 8;
+}
+
+/**
+ * @brief small fast generator, the simulation should not depend on rand()
+ */
+static uint32_t nextRandom()
+{
+  static uint32_t state = 2463534242u;
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+/**
+ * @brief exponential gap of a Poisson arrival process, in microseconds
+ */
+static uint64_t gapUs(double perSecond)
+{
+  double uniform = (nextRandom() + 1.0) / 4294967296.0;
+  return (uint64_t)(-log(uniform) / perSecond * 1e6) + 1;
+}
+
+struct Result
+{
+  std::vector<uint32_t> urgentUs;
+  uint32_t urgentSent;
+  uint32_t bulkSent;
+  uint32_t bulkDelivered;
+};
+
+/**
+ * @brief runs SECONDS of traffic through a queue with the given classes and schedule
+ *
+ * @param load bulk airtime asked for, as a share of the air
+ * @param window frames handed to the radio at once
+ */
+template <size_t Classes>
+static Result run(TxSchedule schedule, double load, uint8_t window = WINDOW)
+{
+  static const uint8_t weights[] = {8, 4, 2, 1};
+  TxQueue<DEPTH, Classes> &queue = *new TxQueue<DEPTH, Classes>(TX_DROP_OLDEST, window, schedule, weights);
+  Result result = {};
+  double bulkPerSecond = load * 1e6 / airtimeUs(BULK_LENGTH);
+
+  // the radio's own queue: packet id and length, the first one is on the air
+  std::vector<std::pair<uint32_t, uint8_t>> radio;
+  std::vector<uint64_t> queuedUs;
+  uint64_t airDoneUs = 0;
+  uint64_t nextUrgentUs = 1000;
+  uint64_t nextBulkUs = gapUs(bulkPerSecond);
+  uint8_t frame[TX_MAX_PACKET];
+  memset(frame, 0, sizeof(frame));
+
+  auto send = [&](TxPacket &packet) -> TxSendResult
+  {
+    uint32_t id;
+    memcpy(&id, packet.data, sizeof(id));
+    radio.push_back(std::make_pair(id, packet.length));
+    return TX_SENT;
+  };
+
+  // no arrivals after SECONDS, then whatever is queued drains
+  const uint64_t endUs = (uint64_t)SECONDS * 1000000;
+  uint64_t nowUs = 0;
+  for (;;)
+  {
+    uint64_t arrivalUs = std::min(nextUrgentUs, nextBulkUs);
+    arrivalUs = arrivalUs < endUs ? arrivalUs : UINT64_MAX;
+    if (!radio.empty() && airDoneUs <= arrivalUs)
+    {
+      nowUs = airDoneUs;
+      uint32_t id = radio.front().first;
+      if (id & 0x80000000u)
+      {
+        result.urgentUs.push_back(nowUs - queuedUs[id & 0x7FFFFFFF]);
+      }
+      else
+      {
+        result.bulkDelivered++;
+      }
+      radio.erase(radio.begin());
+      queue.onSent();
+      if (!radio.empty())
+      {
+        airDoneUs = nowUs + airtimeUs(radio.front().second);
+      }
+    }
+    else if (arrivalUs == UINT64_MAX)
+    {
+      break;
+    }
+    else
+    {
+      nowUs = arrivalUs;
+      bool urgent = nextUrgentUs <= nextBulkUs;
+      uint32_t id = queuedUs.size() | (urgent ? 0x80000000u : 0);
+      queuedUs.push_back(nowUs);
+      memcpy(frame, &id, sizeof(id));
+      if (urgent)
+      {
+        queue.enqueue(frame, frame, URGENT_LENGTH, 0);
+        result.urgentSent++;
+        nextUrgentUs += 1000000 / URGENT_PER_SECOND;
+      }
+      else
+      {
+        queue.enqueue(frame, frame, BULK_LENGTH, 3);
+        result.bulkSent++;
+        nextBulkUs += gapUs(bulkPerSecond);
+      }
+    }
+
+    bool idle = radio.empty();
+    queue.pump(send);
+    if (idle && !radio.empty())
+    {
+      airDoneUs = nowUs + airtimeUs(radio.front().second);
+    }
+  }
+  delete &queue;
+  return result;
+}
+
+static void print(const char *name, double load, Result result)
+{
+  std::vector<uint32_t> &latency = result.urgentUs;
+  std::sort(latency.begin(), latency.end());
+  size_t n = latency.size();
+  printf("%-9s %5.2f  %8.2f %8.2f %8.2f %8u   %8.0f %8.0f\n", name, load, n ? latency[n / 2] / 1000.0 : 0,
+         n ? latency[n * 99 / 100] / 1000.0 : 0, n ? latency[n - 1] / 1000.0 : 0,
+         (unsigned)(result.urgentSent - n), result.bulkSent / (double)SECONDS, result.bulkDelivered / (double)SECONDS);
+}
+
+int main()
+{
+  printf("air: %u us per %u byte bulk frame, %u urgent %u byte messages/s, queue %u per class, window %u\n",
+         (unsigned)airtimeUs(BULK_LENGTH), BULK_LENGTH, URGENT_PER_SECOND, URGENT_LENGTH, DEPTH, WINDOW);
+  printf("strict/1 is strict with one frame handed to the radio at a time\n");
+  printf("%-9s %5s  %8s %8s %8s %8s   %8s %8s\n", "schedule", "load", "p50 ms", "p99 ms", "max ms", "lost",
+         "bulk in/s", "out/s");
+  const double loads[] = {0.1, 0.5, 0.9, 1.0, 1.5, 3.0};
+  for (double load : loads)
+  {
+    print("fifo", load, run<1>(TX_STRICT, load));
+    print("strict", load, run<4>(TX_STRICT, load));
+    print("weighted", load, run<4>(TX_WEIGHTED, load));
+    print("strict/1", load, run<4>(TX_STRICT, load, 1));
+  }
+  return 0;
+}
@@ -0,0 +1,223 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <radio_settings.h>
+#include <relay.h>
+
+/*
+ * RadioSettings on a mocked radio that counts its setRate and setTxPower
+ * calls, once taking every rate like the ESP32 and once only 1 Mbit/s like
+ * the ESP8266. Frames of random classes, with and without their own hint,
+ * go through resolve() and apply() the way pumpTx() sends them, against
+ * per-class hints like the ones a LINK_TYPE_RADIO frame sets. Checks what
+ * each frame resolves to, that the radio is only called for a setting that
+ * changed, a refused one included, and that the ESP8266 refuses every rate
+ * but 1 Mbit/s. Exits with 1 on a failure.
+ */
+
+#define FRAMES 100000
+
+/**
+ * @brief small fast generator, the test should not depend on rand()
+ */
+static uint32_t nextRandom()
+{
+  static uint32_t state = 2463534242u;
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+static bool failedCheck = false;
+
+static void check(bool condition, const char *what)
+{
+  if (!condition && !failedCheck)
+  {
+    fprintf(stderr, "%s\n", what);
+  }
+  failedCheck |= !condition;
+}
+
+/**
+ * @tparam Esp8266 take only the rates the ESP8266 sends at
+ */
+template <bool Esp8266>
+struct MockRadio
+{
+  static uint32_t rateCalls;
+  static uint32_t powerCalls;
+  static uint32_t refused;
+  static uint8_t rate;  /**< the radio's rate, the last one it took */
+  static uint8_t power;
+
+  static bool setRate(uint8_t rate)
+  {
+    rateCalls++;
+    if (rate == LINK_RATE_DEFAULT || rate >= LINK_RATES || (Esp8266 && !radioEsp8266Rate(rate)))
+    {
+      refused++;
+      return false;
+    }
+    MockRadio::rate = rate;
+    return true;
+  }
+
+  static bool setTxPower(uint8_t power)
+  {
+    powerCalls++;
+    check(power >= RADIO_MIN_TX_POWER && power <= RADIO_MAX_TX_POWER, "power out of range handed to the radio");
+    MockRadio::power = power;
+    return true;
+  }
+
+  static void reset()
+  {
+    rateCalls = powerCalls = refused = 0;
+    rate = power = 0;
+  }
+};
+
+template <bool Esp8266>
+uint32_t MockRadio<Esp8266>::rateCalls;
+template <bool Esp8266>
+uint32_t MockRadio<Esp8266>::powerCalls;
+template <bool Esp8266>
+uint32_t MockRadio<Esp8266>::refused;
+template <bool Esp8266>
+uint8_t MockRadio<Esp8266>::rate;
+template <bool Esp8266>
+uint8_t MockRadio<Esp8266>::power;
+
+/**
+ * @brief a random hint, now and then unset or out of range
+ */
+static RadioHint randomHint()
+{
+  RadioHint hint;
+  uint32_t pick = nextRandom() % 16;
+  hint.rate = pick < 4 ? (uint32_t)LINK_RATE_DEFAULT : pick == 4 ? LINK_RATES + nextRandom() % 8 : nextRandom() % LINK_RATES;
+  pick = nextRandom() % 16;
+  hint.power = pick < 4 ? 0 : pick == 4 ? nextRandom() % RADIO_MIN_TX_POWER : pick == 5 ? 85 + nextRandom() % 100
+                                                                                           : nextRandom() % 85;
+  return hint;
+}
+
+/**
+ * @brief what a frame goes out with, worked out on its own: its hint, else its class's, else the node's
+ */
+static RadioHint expectedOf(RadioHint frame, RadioHint forClass, RadioHint defaults)
+{
+  RadioHint result;
+  result.rate = frame.rate != LINK_RATE_DEFAULT && frame.rate < LINK_RATES         ? frame.rate
+                : forClass.rate != LINK_RATE_DEFAULT && forClass.rate < LINK_RATES ? forClass.rate
+                                                                                   : defaults.rate;
+  result.power = frame.power != 0 ? frame.power : forClass.power != 0 ? forClass.power : defaults.power;
+  if (result.power < RADIO_MIN_TX_POWER)
+  {
+    result.power = RADIO_MIN_TX_POWER;
+  }
+  if (result.power > RADIO_MAX_TX_POWER)
+  {
+    result.power = RADIO_MAX_TX_POWER;
+  }
+  return result;
+}
+
+template <bool Esp8266>
+static bool run(const char *name)
+{
+  typedef MockRadio<Esp8266> Radio;
+  failedCheck = false;
+  Radio::reset();
+  const RadioHint defaults = {RADIO_RATE, RADIO_TX_POWER};
+  RadioSettings<Radio> settings(defaults);
+
+  // boot: the node's settings once, then never again while nothing asks for others
+  settings.apply(settings.resolve(RadioHint(), RadioHint()));
+  check(Radio::rateCalls == 1 && Radio::powerCalls == 1, "boot did not set the rate and power once");
+  for (int i = 0; i < 100; i++)
+  {
+    settings.apply(settings.resolve(RadioHint(), RadioHint()));
+  }
+  check(Radio::rateCalls == 1 && Radio::powerCalls == 1 && settings.changes == 2,
+        "a repeated setting reconfigured the radio");
+
+  // the ESP8266 refuses every rate but 1 Mbit/s, once per change
+  for (uint8_t rate = LINK_RATE_1M; rate < LINK_RATES; rate++)
+  {
+    uint32_t calls = Radio::rateCalls;
+    uint32_t refused = settings.refused;
+    RadioHint hint = {rate, 0};
+    settings.apply(settings.resolve(hint, RadioHint()));
+    settings.apply(settings.resolve(hint, RadioHint()));
+    bool taken = !Esp8266 || rate == LINK_RATE_1M;
+    check(settings.refused - refused == (taken ? 0u : 1u), Esp8266 ? "ESP8266 took a rate but 1 Mbit/s"
+                                                                   : "ESP32 refused a rate");
+    check(Radio::rateCalls - calls <= 1, "a refused rate was asked for again");
+  }
+
+  // frames of random classes, the class hints changing now and then like a LINK_TYPE_RADIO frame does
+  RadioHint classRadio[LINK_PRIORITIES] = {};
+  RadioHint last = settings.resolve(RadioHint(), classRadio[0]);
+  settings.apply(last);
+  uint32_t changes = settings.changes;
+  uint32_t expectedChanges = 0;
+  for (uint32_t frame = 0; frame < FRAMES; frame++)
+  {
+    if (nextRandom() % 1000 == 0)
+    {
+      for (RadioHint &hint : classRadio)
+      {
+        hint = RadioSettings<Radio>::valid(randomHint());
+      }
+    }
+    uint8_t priority = nextRandom() % LINK_PRIORITIES;
+    // most frames leave it to their class
+    RadioHint own = nextRandom() % 8 == 0 ? RadioSettings<Radio>::valid(randomHint()) : RadioHint();
+    RadioHint resolved = settings.resolve(own, classRadio[priority]);
+    RadioHint expected = expectedOf(own, classRadio[priority], defaults);
+    check(resolved.rate == expected.rate && resolved.power == expected.power, "a frame resolved to the wrong setting");
+    expectedChanges += (resolved.rate != last.rate) + (resolved.power != last.power);
+    uint32_t rateCalls = Radio::rateCalls;
+    uint32_t powerCalls = Radio::powerCalls;
+    settings.apply(resolved);
+    check(Radio::rateCalls - rateCalls == (resolved.rate != last.rate), "rate call for an unchanged rate, or none");
+    check(Radio::powerCalls - powerCalls == (resolved.power != last.power),
+          "power call for an unchanged power, or none");
+    check(!Esp8266 || Radio::rate == LINK_RATE_1M, "ESP8266 left 1 Mbit/s");
+    if (Radio::power != resolved.power || (!Esp8266 && Radio::rate != resolved.rate))
+    {
+      check(false, "radio not at the frame's setting");
+    }
+    last = resolved;
+  }
+  check(settings.changes - changes == expectedChanges, "change counter differs from the calls");
+  check(settings.refused == Radio::refused, "refused counter differs from the radio");
+  uint32_t randomChanges = settings.changes - changes;
+
+  // the usual case: every class at one setting, frames without their own
+  for (RadioHint &hint : classRadio)
+  {
+    hint = {LINK_RATE_6M, 60};
+  }
+  settings.apply(settings.resolve(RadioHint(), classRadio[0]));
+  changes = settings.changes;
+  for (uint32_t frame = 0; frame < FRAMES; frame++)
+  {
+    settings.apply(settings.resolve(RadioHint(), classRadio[nextRandom() % LINK_PRIORITIES]));
+  }
+  check(settings.changes == changes, "frames of one setting reconfigured the radio");
+
+  printf("%-8s %u frames of random hints: %u radio calls, %u refused; %u frames of one setting: %u radio calls  %s\n",
+         name, (unsigned)FRAMES, (unsigned)randomChanges, (unsigned)settings.refused, (unsigned)FRAMES,
+         (unsigned)(settings.changes - changes), failedCheck ? "FAILED" : "ok");
+  return !failedCheck;
+}
+
+int main()
+{
+  bool ok = run<false>("ESP32");
+  ok = run<true>("ESP8266") && ok;
+  return ok ? 0 : 1;
+}
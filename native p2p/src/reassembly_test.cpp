@@ -0,0 +1,329 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <reassembler.h>
+
+/*
+ * Reassembler on the fragments of messages from a few senders at once, the
+ * fragments of each message shuffled, some lost and some duplicated, the
+ * senders interleaved. Then the pool on its own: partial messages expiring
+ * and making room, complete ones the consumer still holds, malformed
+ * fragments. Exits with 1 when:
+ * - a message without a lost fragment does not come out, or comes out twice,
+ * - a message comes out different from the one sent, or with a fragment missing,
+ * - a duplicated fragment completes a message again or changes it,
+ * - an expired or evicted partial message does not give its buffer back,
+ * - the counters differ from what happened.
+ */
+
+#define SLOTS 8
+#define MAX_MESSAGE 1024
+#define PER_SENDER 2
+#define HEADROOM 10
+#define TAILROOM 2
+#define TIMEOUT_MS 500
+#define SENDERS 3
+#define MESSAGES 60000
+
+typedef Reassembler<SLOTS, MAX_MESSAGE, PER_SENDER, HEADROOM, TAILROOM> Pool;
+
+/**
+ * @brief small fast generator, the test should not depend on rand()
+ */
+static uint32_t nextRandom()
+{
+  static uint32_t state = 2463534242u;
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+static bool failedCheck = false;
+
+static void check(bool condition, const char *what)
+{
+  if (!condition && !failedCheck)
+  {
+    fprintf(stderr, "%s\n", what);
+  }
+  failedCheck |= !condition;
+}
+
+static void macOf(uint32_t sender, uint8_t *macAddr)
+{
+  const uint8_t base[6] = {0x24, 0x6F, 0x28, 0, 0, 0};
+  memcpy(macAddr, base, 6);
+  macAddr[4] = sender >> 8;
+  macAddr[5] = sender;
+}
+
+/**
+ * @brief the bytes of a message, from its sender and number
+ */
+static uint8_t byteOf(uint32_t sender, uint32_t number, size_t i)
+{
+  return sender * 101 + number * 31 + i * 7 + (i >> 8);
+}
+
+static AirFragment fragmentOf(uint32_t number, size_t length, uint8_t index)
+{
+  return {(uint8_t)number, index, (uint8_t)((length + AIR_MAX_FRAGMENT - 1) / AIR_MAX_FRAGMENT), AIR_MAX_FRAGMENT};
+}
+
+/**
+ * @brief hands one fragment of a message to the pool
+ */
+static int addFragment(Pool &pool, uint32_t sender, uint32_t number, size_t length, uint8_t index, uint32_t nowMs)
+{
+  uint8_t macAddr[6];
+  uint8_t data[AIR_MAX_FRAGMENT];
+  macOf(sender, macAddr);
+  AirFragment fragment = fragmentOf(number, length, index);
+  size_t offset = (size_t)index * AIR_MAX_FRAGMENT;
+  size_t part = length - offset < AIR_MAX_FRAGMENT ? length - offset : AIR_MAX_FRAGMENT;
+  for (size_t i = 0; i < part; i++)
+  {
+    data[i] = byteOf(sender, number, offset + i);
+  }
+  return pool.add(macAddr, fragment, data, part, nowMs);
+}
+
+static bool intact(Pool &pool, int slot, uint32_t sender, uint32_t number, size_t length)
+{
+  if (pool.length(slot) != length)
+  {
+    return false;
+  }
+  const uint8_t *message = pool.message(slot);
+  for (size_t i = 0; i < length; i++)
+  {
+    if (message[i] != byteOf(sender, number, i))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief a message on its way: its fragments in the order they arrive
+ */
+struct Message
+{
+  uint32_t number;
+  size_t length;
+  std::vector<uint8_t> arrivals; /**< fragment indexes, duplicates included */
+  size_t next;
+  bool lost;      /**< a fragment never arrives */
+  bool delivered;
+};
+
+/**
+ * @brief the fragments of a message, shuffled, lostPermille of them lost and
+ * dupPermille duplicated. A duplicate arrives before the message is complete,
+ * later ones are the duplicate filter's in front of the pool
+ */
+static void plan(Message &message, uint32_t number, uint32_t lostPermille, uint32_t dupPermille)
+{
+  message.number = number;
+  message.length = AIR_MAX_FRAGMENT + 1 + nextRandom() % (MAX_MESSAGE - AIR_MAX_FRAGMENT);
+  message.arrivals.clear();
+  message.next = 0;
+  message.lost = false;
+  message.delivered = false;
+  uint8_t count = fragmentOf(number, message.length, 0).count;
+  for (uint8_t index = 0; index < count; index++)
+  {
+    if (nextRandom() % 1000 < lostPermille)
+    {
+      message.lost = true;
+      continue;
+    }
+    message.arrivals.push_back(index);
+  }
+  for (size_t i = message.arrivals.size(); i > 1; i--)
+  {
+    size_t j = nextRandom() % i;
+    uint8_t swap = message.arrivals[i - 1];
+    message.arrivals[i - 1] = message.arrivals[j];
+    message.arrivals[j] = swap;
+  }
+  size_t originals = message.arrivals.size();
+  for (size_t i = 0; i + 1 < originals; i++)
+  {
+    if (nextRandom() % 1000 < dupPermille)
+    {
+      // somewhere before the last original fragment
+      size_t at = i + 1 + nextRandom() % (message.arrivals.size() - i - 1);
+      message.arrivals.insert(message.arrivals.begin() + at, message.arrivals[i]);
+    }
+  }
+}
+
+/**
+ * @brief MESSAGES messages from SENDERS senders, fragments interleaved
+ */
+static bool interleaved(uint32_t lostPermille, uint32_t dupPermille)
+{
+  failedCheck = false;
+  Pool &pool = *new Pool(TIMEOUT_MS);
+  Message messages[SENDERS];
+  uint32_t numbers[SENDERS] = {};
+  uint32_t started = 0;
+  uint32_t expected = 0;
+  uint32_t delivered = 0;
+  uint32_t nowMs = 0;
+  for (uint32_t sender = 0; sender < SENDERS; sender++)
+  {
+    plan(messages[sender], numbers[sender]++, lostPermille, dupPermille);
+    started++;
+  }
+  while (started < MESSAGES + SENDERS)
+  {
+    uint32_t sender = nextRandom() % SENDERS;
+    Message &message = messages[sender];
+    if (message.next == message.arrivals.size())
+    {
+      check(message.lost || message.delivered, "a message with every fragment did not come out");
+      expected += !message.lost;
+      plan(message, numbers[sender]++, lostPermille, dupPermille);
+      started++;
+      continue;
+    }
+    uint8_t index = message.arrivals[message.next++];
+    int slot = addFragment(pool, sender, message.number, message.length, index, nowMs++);
+    if (slot != Pool::NONE)
+    {
+      check(!message.lost, "a message with a lost fragment came out");
+      check(!message.delivered, "a duplicated fragment completed a message again");
+      check(message.next == message.arrivals.size(), "a message came out before its last fragment");
+      check(intact(pool, slot, sender, message.number, message.length), "a message came out different");
+      message.delivered = true;
+      delivered++;
+      pool.release(slot);
+    }
+  }
+  for (const Message &message : messages)
+  {
+    if (message.next == message.arrivals.size())
+    {
+      check(message.lost || message.delivered, "a message with every fragment did not come out");
+      expected += !message.lost;
+    }
+  }
+  check(delivered == expected, "messages without a lost fragment missing");
+  check(pool.completed >= delivered, "completed counter behind the messages");
+  check(pool.dropped == 0 && pool.malformed == 0, "a fragment refused");
+  printf("lost %2u/1000  duplicated %3u/1000  messages %6u  rebuilt %6u  evicted %5u  timed out %5u  %s\n",
+         (unsigned)lostPermille, (unsigned)dupPermille, (unsigned)(started - SENDERS), (unsigned)delivered,
+         (unsigned)pool.evicted, (unsigned)pool.timedOut, failedCheck ? "FAILED" : "ok");
+  delete &pool;
+  return !failedCheck;
+}
+
+/**
+ * @brief every buffer partial, complete or taken: what a new message gets
+ */
+static bool pool()
+{
+  failedCheck = false;
+  Pool &pool = *new Pool(TIMEOUT_MS);
+  const size_t length = 3 * AIR_MAX_FRAGMENT;
+
+  // every buffer filling, one sender each: the oldest makes room for a new sender
+  for (uint32_t sender = 0; sender < SLOTS; sender++)
+  {
+    check(addFragment(pool, sender, 0, length, 0, sender) == Pool::NONE, "a partial message came out");
+  }
+  check(addFragment(pool, SLOTS, 0, length, 0, 100) == Pool::NONE && pool.evicted == 1, "a full pool did not evict");
+  // sender 0 was evicted, the rest of its message starts over and never completes
+  check(addFragment(pool, 0, 0, length, 1, 101) == Pool::NONE && addFragment(pool, 0, 0, length, 2, 102) == Pool::NONE,
+        "an evicted message came out");
+  check(pool.evicted == 2, "the restarted message did not evict the next oldest");
+
+  // after the timeout every partial message gives its buffer back
+  uint32_t later = 102 + TIMEOUT_MS;
+  int slot = Pool::NONE;
+  for (uint8_t index = 0; index < 3; index++)
+  {
+    slot = addFragment(pool, 100, 7, length, index, later);
+  }
+  check(slot != Pool::NONE && intact(pool, slot, 100, 7, length), "no message after the timeout");
+  check(pool.timedOut == SLOTS && pool.evicted == 2, "partial messages did not time out");
+  pool.release(slot);
+
+  // duplicates of every fragment, twice in a row: one message
+  uint32_t completed = pool.completed;
+  int out = 0;
+  for (uint8_t index = 0; index < 3; index++)
+  {
+    for (int copy = 0; copy < 2; copy++)
+    {
+      slot = addFragment(pool, 101, 8, length, index, later + 1);
+      out += slot != Pool::NONE;
+      if (slot != Pool::NONE)
+      {
+        check(intact(pool, slot, 101, 8, length), "duplicates changed a message");
+        check(index == 2 && copy == 0, "a message came out at the wrong fragment");
+        pool.release(slot);
+      }
+    }
+  }
+  check(out == 1 && pool.completed == completed + 1, "a duplicated message came out twice");
+
+  // the consumer holds every buffer: a new message is refused until one comes back
+  later += 2 * TIMEOUT_MS;
+  int held[SLOTS];
+  for (uint32_t i = 0; i < SLOTS; i++)
+  {
+    for (uint8_t index = 0; index < 2; index++)
+    {
+      held[i] = addFragment(pool, 200 + i, i, 2 * AIR_MAX_FRAGMENT, index, later);
+    }
+    check(held[i] != Pool::NONE, "a message did not come out");
+  }
+  check(addFragment(pool, 300, 0, length, 0, later) == Pool::NONE && pool.dropped == 1,
+        "a message took a buffer the consumer holds");
+  for (uint32_t i = 0; i < SLOTS; i++)
+  {
+    check(intact(pool, held[i], 200 + i, i, 2 * AIR_MAX_FRAGMENT), "a held message changed");
+  }
+  pool.release(held[3]);
+  for (uint8_t index = 0; index < 3; index++)
+  {
+    slot = addFragment(pool, 300, 0, length, index, later);
+  }
+  check(slot == held[3] && intact(pool, slot, 300, 0, length), "a released buffer was not reused");
+
+  // malformed fragments are refused before they touch a buffer
+  uint8_t macAddr[6];
+  uint8_t data[AIR_MAX_FRAGMENT] = {};
+  macOf(400, macAddr);
+  uint32_t malformed = pool.malformed;
+  check(pool.add(macAddr, {0, 3, 3, AIR_MAX_FRAGMENT}, data, 10, later) == Pool::NONE, "index past the count taken");
+  check(pool.add(macAddr, {0, 0, AIR_MAX_FRAGMENTS + 1, AIR_MAX_FRAGMENT}, data, AIR_MAX_FRAGMENT, later) ==
+            Pool::NONE,
+        "too many fragments taken");
+  check(pool.add(macAddr, {0, 0, 2, AIR_MAX_FRAGMENT}, data, 10, later) == Pool::NONE, "short fragment taken");
+  check(pool.add(macAddr, {0, 4, 5, AIR_MAX_FRAGMENT}, data, AIR_MAX_FRAGMENT, later) == Pool::NONE,
+        "message past MAX_MESSAGE taken");
+  check(pool.malformed == malformed + 4, "malformed fragments not counted");
+
+  printf("pool of %u: eviction, timeout, duplicates, held buffers, malformed fragments  %s\n", (unsigned)SLOTS,
+         failedCheck ? "FAILED" : "ok");
+  delete &pool;
+  return !failedCheck;
+}
+
+int main()
+{
+  bool ok = true;
+  ok = interleaved(0, 0) && ok;
+  ok = interleaved(0, 100) && ok;
+  ok = interleaved(20, 100) && ok;
+  ok = interleaved(100, 300) && ok;
+  ok = pool() && ok;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,323 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <deque>
+#include <vector>
+#include <hal.h>
+#include <tx_engine.h>
+#include <tx_queue.h>
+
+/*
+ * TxQueue and TxEngine on a mocked radio that holds at most RADIO_BUFFERS
+ * frames, refuses sends with RADIO_NO_MEM when full and at random, fails one
+ * in FAIL_ONE_IN for good and completes the frames it took later, in order,
+ * through onSent() like the send callback. One send in HOLD_ONE_IN is held
+ * back before the radio, as congestion control does. Every frame carries its
+ * class and its number within the class. Exits with 1 when:
+ * - more frames are in flight than the window, or the queue's count differs from the radio's,
+ * - a frame refused with RADIO_NO_MEM is not the next one offered,
+ * - the frames of a class leave out of order or twice,
+ * - a frame is lost other than by the drop policy or a failed send,
+ * - a drop policy discards the wrong frames,
+ * - a held send is counted as a retry.
+ */
+
+#define DEPTH 8
+#define CLASSES 2
+#define WINDOW 4
+#define RADIO_BUFFERS 6
+#define FAIL_ONE_IN 50
+#define HOLD_ONE_IN 20
+#define STEPS 200000
+
+/**
+ * @brief small fast generator, the test should not depend on rand()
+ */
+static uint32_t nextRandom()
+{
+  static uint32_t state = 2463534242u;
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+static const uint8_t BROADCAST_ADDRESS[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+typedef TxQueue<DEPTH, CLASSES> Queue;
+
+static bool failedCheck = false;
+
+static void check(bool condition, const char *what)
+{
+  if (!condition && !failedCheck)
+  {
+    fprintf(stderr, "%s\n", what);
+  }
+  failedCheck |= !condition;
+}
+
+struct MockRadio
+{
+  static std::vector<std::vector<uint8_t>> peers;
+  static std::deque<uint32_t> pending; /**< frames taken and not completed yet */
+  static uint32_t noMemPermille;
+  static bool refusing;      /**< the last send was refused with RADIO_NO_MEM */
+  static uint32_t refusedId; /**< class and number of that frame */
+  static uint32_t expected[CLASSES]; /**< number past the last frame taken or failed per class */
+  static uint32_t first[CLASSES];    /**< number of the first one */
+  static uint32_t delivered;
+  static uint32_t failed;
+  static uint32_t noMem;
+
+  static bool addPeer(const uint8_t *macAddr, const uint8_t *lmk = nullptr)
+  {
+    peers.push_back(std::vector<uint8_t>(macAddr, macAddr + 6));
+    return true;
+  }
+
+  static bool removePeer(const uint8_t *macAddr)
+  {
+    for (size_t i = 0; i < peers.size(); i++)
+    {
+      if (memcmp(peers[i].data(), macAddr, 6) == 0)
+      {
+        peers.erase(peers.begin() + i);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  static RadioStatus send(const uint8_t *macAddr, const uint8_t *data, size_t length)
+  {
+    bool known = false;
+    for (const std::vector<uint8_t> &peer : peers)
+    {
+      known |= memcmp(peer.data(), macAddr, 6) == 0;
+    }
+    check(known, "send to an unregistered peer");
+    uint8_t lane = data[0];
+    uint32_t number = data[1] | data[2] << 8 | (uint32_t)data[3] << 16;
+    uint32_t id = (uint32_t)lane << 24 | number;
+    check(!refusing || refusedId == id, "a frame refused with RADIO_NO_MEM was not offered again first");
+    if (pending.size() == RADIO_BUFFERS || nextRandom() % 1000 < noMemPermille)
+    {
+      refusing = true;
+      refusedId = id;
+      noMem++;
+      return RADIO_NO_MEM;
+    }
+    refusing = false;
+    // the drop policy and failed sends leave gaps, nothing may come back
+    check(number >= expected[lane], "frames of a class out of order or repeated");
+    first[lane] = expected[lane] == 0 ? number : first[lane];
+    expected[lane] = number + 1;
+    if (nextRandom() % FAIL_ONE_IN == 0)
+    {
+      failed++;
+      return RADIO_INTERNAL;
+    }
+    pending.push_back(id);
+    delivered++;
+    return RADIO_OK;
+  }
+
+  static void reset(uint32_t noMemPermille)
+  {
+    peers.clear();
+    pending.clear();
+    MockRadio::noMemPermille = noMemPermille;
+    refusing = false;
+    memset(expected, 0, sizeof(expected));
+    memset(first, 0, sizeof(first));
+    delivered = failed = noMem = 0;
+  }
+};
+
+std::vector<std::vector<uint8_t>> MockRadio::peers;
+std::deque<uint32_t> MockRadio::pending;
+uint32_t MockRadio::noMemPermille;
+bool MockRadio::refusing;
+uint32_t MockRadio::refusedId;
+uint32_t MockRadio::expected[CLASSES];
+uint32_t MockRadio::first[CLASSES];
+uint32_t MockRadio::delivered;
+uint32_t MockRadio::failed;
+uint32_t MockRadio::noMem;
+
+static TxEngine<MockRadio, 4> *engine;
+static uint32_t held;
+
+/**
+ * @brief the send of pumpTx(): a hold or RADIO_NO_MEM keeps the frame, other errors drop it
+ */
+static TxSendResult sendPacket(TxPacket &packet)
+{
+  if (nextRandom() % HOLD_ONE_IN == 0)
+  {
+    held++;
+    return TX_HOLD;
+  }
+  RadioStatus result = engine->send(packet.macAddr, packet.data, packet.length);
+  return result == RADIO_OK ? TX_SENT : result == RADIO_NO_MEM ? TX_RETRY : TX_FAILED;
+}
+
+static void frameOf(uint8_t lane, uint32_t number, uint8_t *data)
+{
+  data[0] = lane;
+  data[1] = number;
+  data[2] = number >> 8;
+  data[3] = number >> 16;
+}
+
+/**
+ * @return false if the queue refused the frame (TX_BLOCK)
+ */
+static bool offer(Queue &queue, const uint8_t *macAddr, const uint8_t *data, size_t length, uint8_t lane)
+{
+  uint32_t dropped = queue.dropped;
+  bool taken = queue.enqueue(macAddr, data, length, lane);
+  // drop oldest may discard the frame the radio refused, it heads its class
+  if (queue.dropped != dropped && MockRadio::refusedId >> 24 == lane)
+  {
+    MockRadio::refusing = false;
+  }
+  return taken;
+}
+
+/**
+ * @brief the send callback for the oldest frame in flight
+ */
+static void complete(Queue &queue)
+{
+  if (!MockRadio::pending.empty())
+  {
+    MockRadio::pending.pop_front();
+    queue.onSent();
+  }
+}
+
+/**
+ * @brief radio full, then DEPTH + 3 frames into one class, then the radio drains: which frames come out
+ */
+static bool fillPolicy(TxDropPolicy policy, const char *name)
+{
+  failedCheck = false;
+  MockRadio::reset(1000);
+  engine = new TxEngine<MockRadio, 4>();
+  engine->addPeer(BROADCAST_ADDRESS);
+  Queue &queue = *new Queue(policy, WINDOW);
+  uint8_t data[16] = {};
+  uint32_t refused = 0;
+  for (uint32_t number = 0; number < DEPTH + 3; number++)
+  {
+    frameOf(1, number, data);
+    refused += !offer(queue, BROADCAST_ADDRESS, data, sizeof(data), 1);
+    queue.pump(sendPacket);
+  }
+  check(queue.size() == DEPTH, "a full class does not hold DEPTH frames");
+  MockRadio::noMemPermille = 0;
+  while (queue.size() > 0)
+  {
+    queue.pump(sendPacket);
+    complete(queue);
+  }
+  uint32_t firstOut = MockRadio::first[1];
+  uint32_t last = MockRadio::expected[1] - 1;
+  // a failed send was still offered, the frames out are the ones kept
+  uint32_t out = MockRadio::delivered + MockRadio::failed;
+  switch (policy)
+  {
+  case TX_DROP_OLDEST:
+    check(refused == 0 && queue.dropped == 3 && firstOut == 3 && last == DEPTH + 2,
+          "drop oldest did not keep the newest frames");
+    break;
+  case TX_DROP_NEWEST:
+    check(refused == 0 && queue.dropped == 3 && firstOut == 0 && last == DEPTH - 1,
+          "drop newest did not keep the oldest frames");
+    break;
+  case TX_BLOCK:
+    check(refused == 3 && queue.dropped == 0 && firstOut == 0 && last == DEPTH - 1,
+          "block did not refuse the frames past a full class");
+    break;
+  }
+  check(out == DEPTH && last + 1 - firstOut == DEPTH, "frames of a full class lost");
+  printf("%-12s full class of %u, %u more offered: kept %u to %u, dropped %u, refused %u  %s\n", name,
+         (unsigned)DEPTH, 3u, (unsigned)firstOut, (unsigned)last, (unsigned)queue.dropped, (unsigned)refused,
+         failedCheck ? "FAILED" : "ok");
+  delete &queue;
+  delete engine;
+  return !failedCheck;
+}
+
+/**
+ * @brief frames of both classes to broadcast and to a few unicast peers at
+ * random, the radio refusing noMemPermille of the sends on top of its full buffers
+ */
+static bool stress(TxDropPolicy policy, const char *name, uint32_t noMemPermille)
+{
+  failedCheck = false;
+  MockRadio::reset(noMemPermille);
+  held = 0;
+  engine = new TxEngine<MockRadio, 4>();
+  engine->addPeer(BROADCAST_ADDRESS);
+  Queue &queue = *new Queue(policy, WINDOW, TX_WEIGHTED);
+  uint32_t offered[CLASSES] = {};
+  uint8_t data[32] = {};
+  uint8_t macAddr[6] = {0x24, 0x6F, 0x28, 0, 0, 0};
+  for (uint32_t step = 0; step < STEPS; step++)
+  {
+    uint32_t action = nextRandom() % 10;
+    if (action < 5)
+    {
+      uint8_t lane = nextRandom() % CLASSES;
+      frameOf(lane, offered[lane], data);
+      macAddr[5] = nextRandom() % 8;
+      bool unicast = nextRandom() % 4 == 0;
+      // refused under TX_BLOCK: the caller keeps the frame, its number comes again
+      offered[lane] += offer(queue, unicast ? macAddr : BROADCAST_ADDRESS, data, 4 + nextRandom() % 28, lane);
+    }
+    else if (action < 8)
+    {
+      queue.pump(sendPacket);
+    }
+    else
+    {
+      complete(queue);
+    }
+    check(queue.inFlight() <= WINDOW, "more frames in flight than the window");
+    check(queue.inFlight() == MockRadio::pending.size(), "in flight count differs from the radio");
+  }
+  MockRadio::noMemPermille = 0;
+  while (queue.size() > 0 || !MockRadio::pending.empty())
+  {
+    queue.pump(sendPacket);
+    complete(queue);
+  }
+  uint32_t total = offered[0] + offered[1];
+  check(MockRadio::delivered + MockRadio::failed + queue.dropped == total, "frames lost");
+  check(policy != TX_BLOCK || queue.dropped == 0, "block dropped frames");
+  check(queue.failed == MockRadio::failed && queue.retried == MockRadio::noMem, "queue counters differ from the radio");
+  printf("%-12s no mem %3u/1000  offered %6u  delivered %6u  failed %4u  dropped %6u  retried %6u  held %5u  %s\n",
+         name, (unsigned)noMemPermille, (unsigned)total, (unsigned)MockRadio::delivered, (unsigned)MockRadio::failed,
+         (unsigned)queue.dropped, (unsigned)queue.retried, (unsigned)held, failedCheck ? "FAILED" : "ok");
+  delete &queue;
+  delete engine;
+  return !failedCheck;
+}
+
+int main()
+{
+  bool ok = true;
+  ok = fillPolicy(TX_DROP_OLDEST, "drop oldest") && ok;
+  ok = fillPolicy(TX_DROP_NEWEST, "drop newest") && ok;
+  ok = fillPolicy(TX_BLOCK, "block") && ok;
+  for (uint32_t noMemPermille : {0, 100, 500})
+  {
+    ok = stress(TX_DROP_OLDEST, "drop oldest", noMemPermille) && ok;
+    ok = stress(TX_DROP_NEWEST, "drop newest", noMemPermille) && ok;
+    ok = stress(TX_BLOCK, "block", noMemPermille) && ok;
+  }
+  return ok ? 0 : 1;
+}